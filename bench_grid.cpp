@@ -0,0 +1,529 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "example_tracer/example_tracer.h"
+#include "example_tracer/grid_file.h"
+#include "example_tracer/tool_helpers.h"
+#include "Image2d.h"
+
+// Fixed benchmark of the CPU renderer: every configuration (grid x resolution) renders the same orbit, each view with
+// warm-up frames and timed repeats. Frame times, throughput, grid bytes touched, optional stage timers and perf
+// counters go to stdout and to a JSON file; every view is compared against a golden image so that a speed-up can't
+// hide a quality regression.
+
+// hardware counters of this process and of the threads it creates after Open (the render pool must come later)
+struct PerfCounters
+{
+  enum { CYCLES = 0, INSTRUCTIONS = 1, CACHE_MISSES = 2, COUNT = 3 };
+
+  #if defined(__linux__)
+  int fd[COUNT] = {-1, -1, -1};
+
+  bool Open()
+  {
+    const uint64_t configs[COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+    for(int i = 0; i < COUNT; i++)
+    {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.type           = PERF_TYPE_HARDWARE;
+      attr.size           = sizeof(attr);
+      attr.config         = configs[i];
+      attr.disabled       = 1;
+      attr.inherit        = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      fd[i] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+      if(fd[i] < 0)
+      {
+        std::cout << "[PerfCounters::Open]: perf_event_open failed (see /proc/sys/kernel/perf_event_paranoid), counters are off" << std::endl;
+        Close();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Close()
+  {
+    for(int i = 0; i < COUNT; i++)
+      if(fd[i] >= 0)
+        close(fd[i]);
+    std::fill(fd, fd + COUNT, -1);
+  }
+
+  bool IsOpen() const { return fd[0] >= 0; }
+
+  void Start()
+  {
+    for(int i = 0; i < COUNT && IsOpen(); i++)
+    {
+      ioctl(fd[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  void Stop(uint64_t a_values[COUNT])
+  {
+    for(int i = 0; i < COUNT; i++)
+    {
+      a_values[i] = 0;
+      if(!IsOpen())
+        continue;
+      ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+      if(read(fd[i], &a_values[i], sizeof(uint64_t)) != sizeof(uint64_t))
+        a_values[i] = 0;
+    }
+  }
+
+  ~PerfCounters() { Close(); }
+  #else
+  bool Open()        { std::cout << "[PerfCounters::Open]: perf_event is Linux only, counters are off" << std::endl; return false; }
+  bool IsOpen() const { return false; }
+  void Start() {}
+  void Stop(uint64_t a_values[COUNT]) { std::fill(a_values, a_values + COUNT, uint64_t(0)); }
+  #endif
+};
+
+struct BenchResult
+{
+  std::string scene;
+  uint32_t    gridSize     = 0;
+  uint32_t    resolution   = 0;
+  size_t      frames       = 0;
+  float       medianMs     = 0.0f;
+  float       p99Ms        = 0.0f;
+  double      raysPerSec   = 0.0;
+  double      samplesPerSec = 0.0;
+  float       samplesPerRay = 0.0f;
+  size_t      gridBytes    = 0;
+  double      touchedBytes = 0.0;       // per frame, averaged over views
+  float       stageMs[4]   = {0, 0, 0, 0}; // per frame, single threaded, averaged over views
+  bool        perf         = false;
+  double      cacheMissesPerFrame = 0.0;
+  double      ipc          = 0.0;
+  float       minPSNR      = INFINITY;
+  int         maxDiff      = 0;
+  std::string golden       = "none";   // none, pass, fail, missing, written
+};
+
+// one camera distance and LOD policy of --lod-sweep
+struct LodResult
+{
+  std::string scene;
+  uint32_t    gridSize       = 0;
+  uint32_t    resolution     = 0;
+  float       distance       = 0.0f;
+  std::string policy;
+  float       medianMs       = 0.0f;
+  double      samplesPerFrame = 0.0;
+  float       minPSNR        = INFINITY; // against LOD_OFF at the same distance
+};
+
+static const struct { const char* name; uint32_t policy; float bias; } LOD_POLICIES[] =
+{
+  {"off", LOD_OFF, 0.0f}, {"footprint", LOD_FOOTPRINT, 0.0f}, {"footprint+1", LOD_FOOTPRINT, 1.0f}
+};
+
+// renders the orbit at several distances with every LOD policy; LOD_OFF comes first and is the reference image
+static void RunLodSweep(RayMarcherExample& a_renderer, const std::string& a_scene, uint32_t a_gridSize, uint32_t a_res, uint32_t a_views,
+                        uint32_t a_warmup, uint32_t a_repeat, std::vector<LodResult>& a_results)
+{
+  const float distances[] = {1.3f, 2.5f, 5.0f, 10.0f};
+  std::vector<uint> pixels(size_t(a_res)*a_res);
+  std::vector<std::vector<uint> > reference(a_views);
+  for(float distance : distances)
+  {
+    for(const auto& policy : LOD_POLICIES)
+    {
+      a_renderer.SetLodPolicy(policy.policy, policy.bias);
+      LodResult result;
+      result.scene      = a_scene;
+      result.gridSize   = a_gridSize;
+      result.resolution = a_res;
+      result.distance   = distance;
+      result.policy     = policy.name;
+
+      std::vector<float> frameMs;
+      double samples = 0.0;
+      for(uint32_t k = 0; k < a_views; k++)
+      {
+        a_renderer.SetWorldViewMatrix(OrbitView(k, a_views, distance));
+        for(uint32_t w = 0; w < a_warmup; w++)
+          a_renderer.RayMarch(pixels.data(), a_res, a_res);
+        for(uint32_t r = 0; r < a_repeat; r++)
+        {
+          const auto start = std::chrono::high_resolution_clock::now();
+          a_renderer.RayMarch(pixels.data(), a_res, a_res);
+          frameMs.push_back(float(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count()));
+          samples += double(a_renderer.GetSamplesPerRay())*double(a_res)*double(a_res);
+        }
+        if(policy.policy == LOD_OFF)
+          reference[k] = pixels;
+        else
+          result.minPSNR = std::min(result.minPSNR, PSNR(pixels, reference[k], a_res, a_res));
+      }
+      result.medianMs        = Percentile(frameMs, 50.0f);
+      result.samplesPerFrame = samples/double(frameMs.size());
+      a_results.push_back(result);
+
+      std::cout << a_scene << " " << a_res << "x" << a_res << ", distance " << distance << ", lod " << std::setw(11) << std::left << policy.name << std::right
+                << ": median = " << result.medianMs << " ms, samples/frame = " << result.samplesPerFrame;
+      if(policy.policy != LOD_OFF)
+        std::cout << ", min PSNR to off = " << result.minPSNR << " dB";
+      std::cout << std::endl;
+    }
+  }
+  a_renderer.SetLodPolicy(LOD_OFF);
+  std::cout << "  lod pyramid = " << double(a_renderer.GetLodBytes())/(1024.0*1024.0) << " MB" << std::endl;
+}
+
+// --progressive: RayMarchProgressive in budget sized calls against one full RayMarch of the same view
+struct ProgressiveResult
+{
+  std::string scene;
+  uint32_t    gridSize     = 0;
+  uint32_t    resolution   = 0;
+  float       budgetMs     = 0.0f;
+  float       fullMs       = 0.0f;  // median over views
+  float       firstImageMs = 0.0f;  // median over views, the first call always returns a complete coarse image
+  float       totalMs      = 0.0f;  // median over views, all calls until coverage 1
+  float       curveFullMs  = 0.0f;  // full frame of view 0
+  int         maxDiff      = 0;     // finished frames against the full ones, over r, g, b of all views
+  bool        converged    = true;  // maxDiff within the tolerance RunProgressive was given
+  std::vector<float3> curve;        // view 0: elapsed ms, coverage, PSNR to the full frame after every call
+};
+
+// finished frames may differ from the full ones by a_maxDiff: progressive traces single rays, RayMarch may use packets
+static void RunProgressive(RayMarcherExample& a_renderer, const std::string& a_scene, uint32_t a_gridSize, uint32_t a_res, uint32_t a_views,
+                           float a_budgetMs, int a_maxDiff, std::vector<ProgressiveResult>& a_results)
+{
+  ProgressiveResult result;
+  result.scene      = a_scene;
+  result.gridSize   = a_gridSize;
+  result.resolution = a_res;
+  result.budgetMs   = a_budgetMs;
+
+  std::vector<uint>  full(size_t(a_res)*a_res), partial(size_t(a_res)*a_res);
+  std::vector<float> fullMs, firstMs, totalMs;
+  for(uint32_t k = 0; k < a_views; k++)
+  {
+    a_renderer.SetWorldViewMatrix(OrbitView(k, a_views));
+    a_renderer.RayMarch(full.data(), a_res, a_res); // warm-up
+    auto start = std::chrono::high_resolution_clock::now();
+    a_renderer.RayMarch(full.data(), a_res, a_res);
+    fullMs.push_back(float(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count()));
+
+    a_renderer.ResetProgressive();
+    float  coverage = 0.0f;
+    double elapsed  = 0.0;
+    while(coverage < 1.0f)
+    {
+      start    = std::chrono::high_resolution_clock::now();
+      coverage = a_renderer.RayMarchProgressive(partial.data(), a_res, a_res, a_budgetMs);
+      elapsed += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+      if(firstMs.size() == k)
+        firstMs.push_back(float(elapsed));
+      if(k == 0)
+        result.curve.push_back(float3(float(elapsed), coverage, PSNR(partial, full, a_res, a_res)));
+    }
+    totalMs.push_back(float(elapsed));
+    result.maxDiff = std::max(result.maxDiff, MaxChannelDiff(partial, full));
+  }
+  result.fullMs       = Percentile(fullMs, 50.0f);
+  result.firstImageMs = Percentile(firstMs, 50.0f);
+  result.totalMs      = Percentile(totalMs, 50.0f);
+  result.curveFullMs  = fullMs[0];
+  result.converged    = result.maxDiff <= a_maxDiff;
+  a_results.push_back(result);
+
+  std::cout << a_scene << " " << a_res << "x" << a_res << ", budget " << a_budgetMs << " ms: full frame = " << result.fullMs << " ms, first image = "
+            << result.firstImageMs << " ms, finished = " << result.totalMs << " ms, finished frames " << (result.converged ? "match" : "DIFFER FROM")
+            << " the full ones (max channel diff = " << result.maxDiff << ")" << std::endl;
+  std::cout << "  view 0, full frame = " << result.curveFullMs << " ms (ms, coverage, PSNR):";
+  for(const float3& point : result.curve)
+    std::cout << " (" << point.x << ", " << point.y << ", " << point.z << ")";
+  std::cout << std::endl;
+}
+
+static void WriteJSON(std::ostream& out, const std::vector<BenchResult>& a_results, const std::vector<LodResult>& a_lod,
+                      const std::vector<ProgressiveResult>& a_progressive, uint32_t a_threads, uint32_t a_packet, const std::string& a_sh, uint32_t a_views,
+                      uint32_t a_warmup, uint32_t a_repeat)
+{
+  const char* stageNames[4] = {"ray_setup", "box_intersection", "marching", "pixel_packing"};
+  out << std::setprecision(9);
+  out << "{\n  \"threads\": " << a_threads << ", \"packet\": " << a_packet << ", \"sh\": \"" << a_sh << "\", \"views\": " << a_views
+      << ", \"warmup\": " << a_warmup << ", \"repeat\": " << a_repeat << ",\n  \"results\": [\n";
+  for(size_t i = 0; i < a_results.size(); i++)
+  {
+    const BenchResult& r = a_results[i];
+    out << "    {\"scene\": \"" << r.scene << "\", \"grid\": " << r.gridSize << ", \"width\": " << r.resolution << ", \"height\": " << r.resolution
+        << ", \"frames\": " << r.frames << ", \"median_ms\": " << r.medianMs << ", \"p99_ms\": " << r.p99Ms
+        << ", \"rays_per_s\": " << r.raysPerSec << ", \"samples_per_s\": " << r.samplesPerSec << ", \"samples_per_ray\": " << r.samplesPerRay
+        << ", \"grid_bytes\": " << r.gridBytes << ", \"touched_bytes_per_frame\": " << r.touchedBytes << ", \"stage_ms\": {";
+    for(int s = 0; s < 4; s++)
+      out << (s == 0 ? "" : ", ") << "\"" << stageNames[s] << "\": " << r.stageMs[s];
+    out << "}, \"perf\": ";
+    if(r.perf)
+      out << "{\"cache_misses_per_frame\": " << r.cacheMissesPerFrame << ", \"ipc\": " << r.ipc << "}";
+    else
+      out << "null";
+    out << ", \"min_psnr_db\": ";
+    if(std::isfinite(r.minPSNR))
+      out << r.minPSNR;
+    else
+      out << "null";                   // identical images, JSON has no infinity
+    out << ", \"max_channel_diff\": " << r.maxDiff << ", \"golden\": \"" << r.golden << "\"}" << (i + 1 < a_results.size() ? "," : "") << "\n";
+  }
+  out << "  ],\n  \"lod\": [\n";
+  for(size_t i = 0; i < a_lod.size(); i++)
+  {
+    const LodResult& r = a_lod[i];
+    out << "    {\"scene\": \"" << r.scene << "\", \"grid\": " << r.gridSize << ", \"width\": " << r.resolution << ", \"height\": " << r.resolution
+        << ", \"distance\": " << r.distance << ", \"policy\": \"" << r.policy << "\", \"median_ms\": " << r.medianMs
+        << ", \"samples_per_frame\": " << r.samplesPerFrame << ", \"min_psnr_db\": ";
+    if(std::isfinite(r.minPSNR))
+      out << r.minPSNR;
+    else
+      out << "null";
+    out << "}" << (i + 1 < a_lod.size() ? "," : "") << "\n";
+  }
+  out << "  ],\n  \"progressive\": [\n";
+  for(size_t i = 0; i < a_progressive.size(); i++)
+  {
+    const ProgressiveResult& r = a_progressive[i];
+    out << "    {\"scene\": \"" << r.scene << "\", \"grid\": " << r.gridSize << ", \"width\": " << r.resolution << ", \"height\": " << r.resolution
+        << ", \"budget_ms\": " << r.budgetMs << ", \"full_ms\": " << r.fullMs << ", \"first_image_ms\": " << r.firstImageMs
+        << ", \"finished_ms\": " << r.totalMs << ", \"curve_full_ms\": " << r.curveFullMs
+        << ", \"max_diff\": " << r.maxDiff << ", \"converged\": " << (r.converged ? "true" : "false") << ", \"curve\": [";
+    for(size_t j = 0; j < r.curve.size(); j++)
+    {
+      out << (j == 0 ? "" : ", ") << "{\"ms\": " << r.curve[j].x << ", \"coverage\": " << r.curve[j].y << ", \"psnr_db\": ";
+      if(std::isfinite(r.curve[j].z))
+        out << r.curve[j].z;
+      else
+        out << "null";
+      out << "}";
+    }
+    out << "]}" << (i + 1 < a_progressive.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+int main(int argc, const char** argv)
+{
+  std::vector<uint32_t> grids       = {64, 128};
+  std::vector<uint32_t> resolutions = {256, 512};
+  std::string modelPath;
+  std::string goldenDir;
+  std::string jsonPath    = "bench_grid.json";
+  std::string shName      = "fp32";
+  bool        updateGolden = false;
+  bool        usePerf      = false;
+  bool        lodSweep     = false;
+  float       progressiveBudget = 0.0f;
+  uint32_t    views       = 8;
+  uint32_t    warmup      = 1;
+  uint32_t    repeat      = 3;
+  uint32_t    threads     = 0;
+  uint32_t    tileSize    = 32;
+  uint32_t    packetWidth = 0;
+  float       minPSNR     = 45.0f;
+  for(int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    if(arg == "--update-golden")
+      updateGolden = true;
+    else if(arg == "--perf")
+      usePerf = true;
+    else if(arg == "--lod-sweep")
+      lodSweep = true;
+    else if(i + 1 >= argc)
+    {
+      std::cout << "usage: bench_grid [--model grid.plnx] [--grids 64,128] [--res 256,512] [--views 8] [--warmup 1] [--repeat 3]" << std::endl;
+      std::cout << "                  [--threads 0] [--tile 32] [--packet 0|4|8|16|auto] [--sh fp32|fp16|q8] [--perf] [--lod-sweep] [--progressive <budget ms>]" << std::endl;
+      std::cout << "                  [--golden <dir>] [--update-golden] [--min-psnr 45] [--json bench_grid.json]" << std::endl;
+      return 1;
+    }
+    else if(arg == "--model")    modelPath   = argv[++i];
+    else if(arg == "--grids")    grids       = ParseList(argv[++i]);
+    else if(arg == "--res")      resolutions = ParseList(argv[++i]);
+    else if(arg == "--views")    views       = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--warmup")   warmup      = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--repeat")   repeat      = std::max(1u, uint32_t(std::stoul(argv[++i])));
+    else if(arg == "--threads")  threads     = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--tile")     tileSize    = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--packet")   { ++i; packetWidth = (std::string(argv[i]) == "auto") ? RayMarcherExample::BestRayPacketWidth() : uint32_t(std::stoul(argv[i])); }
+    else if(arg == "--sh")       shName      = argv[++i];
+    else if(arg == "--golden")   goldenDir   = argv[++i];
+    else if(arg == "--min-psnr") minPSNR     = std::stof(argv[++i]);
+    else if(arg == "--progressive") progressiveBudget = std::stof(argv[++i]);
+    else if(arg == "--json")     jsonPath    = argv[++i];
+  }
+  const uint32_t shStorage = (shName == "fp16") ? SH_STORAGE_FP16 : (shName == "q8") ? SH_STORAGE_Q8 : SH_STORAGE_FP32;
+  if(!modelPath.empty())
+    grids = {0};                       // the model's own size
+
+  PerfCounters counters;
+  if(usePerf)
+    usePerf = counters.Open();
+
+  RayMarcherExample renderer;
+  renderer.SetRenderThreads(threads, tileSize);
+  renderer.SetRayPacketWidth(packetWidth);
+  renderer.SetWorldViewMProjatrix(perspectiveMatrix(45, 1, 0.1, 100));
+
+  std::vector<BenchResult> results;
+  std::vector<LodResult>   lodResults;
+  std::vector<ProgressiveResult> progressiveResults;
+  bool qualityOk = true;
+  for(uint32_t gridSize : grids)
+  {
+    std::string scene;
+    if(modelPath.empty())
+    {
+      BuildSyntheticGrid(renderer, gridSize);
+      scene = "synthetic" + std::to_string(gridSize);
+    }
+    else
+    {
+      if(!LoadGridFile(modelPath.c_str(), renderer))
+        return 1;
+      gridSize = uint32_t(renderer.gridSize);
+      scene    = modelPath.substr(modelPath.find_last_of("/\\") + 1);
+      scene    = scene.substr(0, scene.find_last_of('.'));
+    }
+    renderer.SetSHStorage(shStorage);
+
+    // --lod-sweep and --progressive replace the regular runs
+    for(uint32_t res : resolutions)
+    {
+      if(lodSweep || progressiveBudget > 0.0f)
+      {
+        if(lodSweep)
+          RunLodSweep(renderer, scene, gridSize, res, views, warmup, repeat, lodResults);
+        if(progressiveBudget > 0.0f)
+        {
+          RunProgressive(renderer, scene, gridSize, res, views, progressiveBudget, packetWidth == 0 ? 0 : 1, progressiveResults);
+          qualityOk = qualityOk && progressiveResults.back().converged;
+        }
+        continue;
+      }
+
+      BenchResult result;
+      result.scene      = scene;
+      result.gridSize   = gridSize;
+      result.resolution = res;
+      result.gridBytes  = renderer.gridDensity.size()*sizeof(float) + renderer.GetSHBytes();
+
+      std::vector<uint>  pixels(size_t(res)*res), profiled(size_t(res)*res);
+      std::vector<float> frameMs;
+      double   totalSeconds = 0.0, totalSamples = 0.0;
+      uint64_t perfTotal[PerfCounters::COUNT] = {0, 0, 0};
+      for(uint32_t k = 0; k < views; k++)
+      {
+        renderer.SetWorldViewMatrix(OrbitView(k, views));
+        for(uint32_t w = 0; w < warmup; w++)
+          renderer.RayMarch(pixels.data(), res, res);
+
+        if(usePerf)
+          counters.Start();
+        for(uint32_t r = 0; r < repeat; r++)
+        {
+          const auto start = std::chrono::high_resolution_clock::now();
+          renderer.RayMarch(pixels.data(), res, res);
+          const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+          frameMs.push_back(float(seconds*1000.0));
+          totalSeconds += seconds;
+          totalSamples += double(renderer.GetSamplesPerRay())*double(res)*double(res);
+        }
+        if(usePerf)
+        {
+          uint64_t values[PerfCounters::COUNT];
+          counters.Stop(values);
+          for(int c = 0; c < PerfCounters::COUNT; c++)
+            perfTotal[c] += values[c];
+        }
+
+        // one profiled frame per view: stage breakdown and the cells it reads
+        renderer.SetRayMarchProfiling(true);
+        renderer.RayMarch(profiled.data(), res, res);
+        renderer.SetRayMarchProfiling(false);
+        float stages[4] = {0, 0, 0, 0};
+        renderer.GetExecutionTime("RayMarchStages", stages);
+        for(int s = 0; s < 4; s++)
+          result.stageMs[s] += stages[s]/float(views);
+        result.touchedBytes += double(renderer.GetTouchedGridBytes())/double(views);
+
+        if(goldenDir.empty())
+          continue;
+        std::stringstream name;
+        name << goldenDir << "/" << scene << "_" << res << "_" << std::setw(2) << std::setfill('0') << k << ".bmp";
+        int width = 0, height = 0;
+        std::vector<uint> golden = updateGolden ? std::vector<uint>() : LiteImage::LoadBMP(name.str().c_str(), &width, &height);
+        if(updateGolden)
+        {
+          LiteImage::SaveBMP(name.str().c_str(), pixels.data(), int(res), int(res));
+          result.golden = "written";
+        }
+        else if(golden.size() != pixels.size() || uint32_t(width) != res || uint32_t(height) != res)
+        {
+          std::cout << "[bench_grid]: no golden image '" << name.str() << "'" << std::endl;
+          result.golden = "missing";
+        }
+        else
+        {
+          result.minPSNR = std::min(result.minPSNR, PSNR(pixels, golden, res, res));
+          result.maxDiff = std::max(result.maxDiff, MaxChannelDiff(pixels, golden));
+          if(result.golden != "fail" && result.golden != "missing")
+            result.golden = (result.minPSNR >= minPSNR) ? "pass" : "fail";
+        }
+      }
+
+      result.frames        = frameMs.size();
+      result.medianMs      = Percentile(frameMs, 50.0f);
+      result.p99Ms         = Percentile(frameMs, 99.0f);
+      result.raysPerSec    = double(res)*double(res)*double(result.frames)/totalSeconds;
+      result.samplesPerSec = totalSamples/totalSeconds;
+      result.samplesPerRay = float(totalSamples/(double(res)*double(res)*double(result.frames)));
+      if(usePerf && perfTotal[PerfCounters::CYCLES] != 0)
+      {
+        result.perf                = true;
+        result.cacheMissesPerFrame = double(perfTotal[PerfCounters::CACHE_MISSES])/double(result.frames);
+        result.ipc                 = double(perfTotal[PerfCounters::INSTRUCTIONS])/double(perfTotal[PerfCounters::CYCLES]);
+      }
+      qualityOk = qualityOk && result.golden != "fail" && result.golden != "missing"; // a wrong --golden dir must not pass
+
+      std::cout << scene << " " << res << "x" << res << ": median = " << result.medianMs << " ms, p99 = " << result.p99Ms << " ms, rays/s = " << result.raysPerSec
+                << ", samples/s = " << result.samplesPerSec << ", samplesPerRay = " << result.samplesPerRay << ", touched = " << result.touchedBytes/(1024.0*1024.0)
+                << " MB of " << double(result.gridBytes)/(1024.0*1024.0) << " MB" << std::endl;
+      std::cout << "  stages (1 thread, profiled): setup = " << result.stageMs[0] << " ms, box = " << result.stageMs[1] << " ms, march = " << result.stageMs[2]
+                << " ms, pack = " << result.stageMs[3] << " ms" << std::endl;
+      if(result.perf)
+        std::cout << "  perf: cache misses/frame = " << result.cacheMissesPerFrame << ", IPC = " << result.ipc << std::endl;
+      if(result.golden != "none")
+        std::cout << "  golden: " << result.golden << ", min PSNR = " << result.minPSNR << " dB, max channel diff = " << result.maxDiff << std::endl;
+      results.push_back(result);
+    }
+  }
+
+  std::ofstream json(jsonPath);
+  WriteJSON(json, results, lodResults, progressiveResults, threads, packetWidth, shName, views, warmup, repeat);
+  std::cout << "wrote '" << jsonPath << "'" << (qualityOk ? "" : ", QUALITY REGRESSION or missing golden images") << std::endl;
+  return qualityOk ? 0 : 2;
+}
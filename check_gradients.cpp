@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+#include "example_tracer/example_tracer.h"
+#include "example_tracer/grid_trainer.h"
+#include "example_tracer/tool_helpers.h"
+
+// compares the analytic gradient of GridTrainer with central differences of its loss on a small smooth grid, for
+// density and a few SH coefficients of the cells with the largest gradients, once without TV and once with it; fails
+// (exit code 1) if any of them is off by more than 2%. Densities and colors stay clear of every clamp and threshold of
+// the marcher, so the loss is smooth there. Registered with ctest.
+int main()
+{
+  const uint32_t N       = 12;
+  const uint32_t res     = 24;
+  const float    shDC    = 1.0f/0.28209479177387814f;
+  const uint32_t checked = 8;
+
+  RayMarcherExample grid;
+  grid.InitGrid(N);
+  grid.SetBoundingBox(float3(0, 0, 0), float3(1, 1, 1));
+  grid.SetEmptySpaceSkipping(false);
+  for(uint32_t z = 0; z < N; z++)
+    for(uint32_t y = 0; y < N; y++)
+      for(uint32_t x = 0; x < N; x++)
+      {
+        const size_t cell = x + y*size_t(N) + z*size_t(N)*N;
+        const float3 p    = (float3(float(x), float(y), float(z)) + 0.5f)/float(N);
+        grid.gridDensity[cell] = 1.5f + std::sin(7.0f*p.x + 1.0f)*std::cos(5.0f*p.y)*std::sin(6.0f*p.z + 2.0f);
+        float* sh = grid.gridSH.data() + cell*SH_COEFFS;
+        for(uint32_t k = 0; k < SH_COEFFS; k++)
+          sh[k] = 0.05f*std::sin(float(k + 1)*(p.x + 2.0f*p.y + 3.0f*p.z));
+        sh[0*SH_WIDTH] = (0.35f + 0.2f*p.x + 0.1f*p.y + 0.05f*p.z)*shDC; // TV has no kink where no axis is flat
+        sh[1*SH_WIDTH] = (0.35f + 0.05f*p.x + 0.2f*p.y + 0.1f*p.z)*shDC;
+        sh[2*SH_WIDTH] = (0.35f + 0.1f*p.x + 0.05f*p.y + 0.2f*p.z)*shDC;
+      }
+  grid.RebuildOccupancy();
+
+  TrainView view;
+  view.width     = res;
+  view.height    = res;
+  view.worldView = OrbitView(1, 3);
+  view.proj      = perspectiveMatrix(45.0f, 1.0f, 0.1f, 100.0f);
+  view.viewInv   = inverse4x4(view.worldView);
+  view.projInv   = inverse4x4(view.proj);
+  view.pixels.assign(size_t(res)*res, float3(0.25f, 0.3f, 0.35f));
+
+  grid.SetRenderThreads(1);
+  GridTrainer trainer(grid);
+  const uint32_t params = GridTrainer::PARAMS;
+
+  // density, the DC of red, a linear coefficient of green and a quadratic one of blue
+  const uint32_t tested[4] = {0, 1 + 0*SH_WIDTH, 1 + 1*SH_WIDTH + 2, 1 + 2*SH_WIDTH + 6};
+  bool ok = true;
+  for(float tv : {0.0f, 1e-3f}) // without TV the rendering terms alone, with it TV dominates the density gradients
+  {
+    trainer.settings.tvDensity = tv;
+    trainer.settings.tvSH      = tv;
+
+    std::vector<float> gradient, unused;
+    trainer.ViewLoss(view, &gradient);
+
+    std::vector<uint32_t> cells(size_t(N)*N*N);
+    std::iota(cells.begin(), cells.end(), 0u);
+    std::partial_sort(cells.begin(), cells.begin() + checked, cells.end(),
+                      [&](uint32_t a, uint32_t b) { return std::abs(gradient[a*params]) > std::abs(gradient[b*params]); });
+    double largest = 0.0;
+    for(uint32_t i = 0; i < checked; i++)
+      for(uint32_t p : tested)
+        largest = std::max(largest, double(std::abs(gradient[size_t(cells[i])*params + p])));
+
+    float maxError = 0.0f;
+    for(uint32_t i = 0; i < checked; i++)
+    {
+      for(uint32_t p : tested)
+      {
+        const uint32_t cell  = cells[i];
+        float&         value = (p == 0) ? grid.gridDensity[cell] : grid.gridSH[size_t(cell)*SH_COEFFS + p - 1];
+        const float    saved = value;
+        const float    eps   = 2e-3f;
+        value = saved + eps;
+        const double up = trainer.ViewLoss(view, &unused);
+        value = saved - eps;
+        const double down = trainer.ViewLoss(view, &unused);
+        value = saved;
+
+        const double numeric  = (up - down)/(2.0*double(eps));
+        const double analytic = gradient[size_t(cell)*params + p];
+        const double scale    = std::max(std::max(std::abs(numeric), std::abs(analytic)), 1e-2*largest);
+        const double error    = std::abs(numeric - analytic)/scale;
+        maxError = std::max(maxError, float(error));
+        if(error > 0.02)
+        {
+          std::cout << "cell " << cell << ", param " << p << ": analytic = " << analytic << ", central difference = " << numeric << " (MISMATCH)" << std::endl;
+          ok = false;
+        }
+      }
+    }
+    std::cout << "TV " << tv << ": " << checked*4 << " gradients of " << checked << " cells, max relative error = " << maxError
+              << (maxError <= 0.02f ? " (ok)" : " (MISMATCH)") << std::endl;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+
+#include "example_tracer/example_tracer.h"
+#include "example_tracer/grid_file.h"
+#include "example_tracer/tool_helpers.h"
+
+static bool SamePlanes(const RayMarcherExample& a_grid, const RayMarcherExample& a_reference)
+{
+  return a_grid.gridSize == a_reference.gridSize &&
+         a_grid.gridDensity.size() == a_reference.gridDensity.size() && a_grid.gridSH.size() == a_reference.gridSH.size() &&
+         std::memcmp(a_grid.gridDensity.data(), a_reference.gridDensity.data(), a_grid.gridDensity.size()*sizeof(float)) == 0 &&
+         std::memcmp(a_grid.gridSH.data(),      a_reference.gridSH.data(),      a_grid.gridSH.size()*sizeof(float))      == 0;
+}
+
+static std::vector<uint32_t> Render(RayMarcherExample& a_grid, uint32_t a_res)
+{
+  std::vector<uint32_t> pixels(size_t(a_res)*a_res);
+  a_grid.SetWorldViewMProjatrix(perspectiveMatrix(45, 1, 0.1, 100));
+  a_grid.SetWorldViewMatrix(OrbitView(1, 3, 2.5f));
+  a_grid.RayMarch(pixels.data(), a_res, a_res);
+  return pixels;
+}
+
+// saves a synthetic grid with raw and sparse brick sections and loads it back; fails (exit code 1) if the loaded
+// planes or a render of them (which also sees the bounding box) differ at all, or if a truncated file or one of
+// version 0 is accepted or changes the grid it was loaded into. Writes and removes its files in the working
+// directory. Registered with ctest.
+int main()
+{
+  const uint32_t gridSize = 37; // partial bricks at the far sides
+  const uint32_t res      = 96;
+
+  RayMarcherExample source;
+  BuildSyntheticGrid(source, gridSize);
+  for(size_t cell = 0; cell < source.gridDensity.size(); cell++) // so that SH has empty bricks as well
+    if(source.gridDensity[cell] == 0.0f)
+      std::fill(source.gridSH.data() + cell*SH_COEFFS, source.gridSH.data() + (cell + 1)*SH_COEFFS, 0.0f);
+  source.SetBoundingBox(float3(-0.25f, 0.0f, 0.1f), float3(1.25f, 1.5f, 1.2f));
+  source.RebuildOccupancy();
+  const std::vector<uint32_t> reference = Render(source, res);
+
+  bool ok = true;
+  for(bool sparse : {false, true})
+  {
+    const std::string fileName = sparse ? "check_grid_file_sparse.plnx" : "check_grid_file_raw.plnx";
+    RayMarcherExample loaded;
+    GridFileStats     stats;
+    const bool saved = SaveGridFile(fileName.c_str(), source, sparse);
+    const bool read  = saved && LoadGridFile(fileName.c_str(), loaded, &stats);
+    const bool same  = read && SamePlanes(loaded, source) && Render(loaded, res) == reference;
+
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    const size_t fileSize = file ? size_t(file.tellg()) : 0;
+    std::cout << (sparse ? "sparse bricks" : "raw") << ": " << fileSize << " bytes, " << stats.bytesInPlace << " in place, "
+              << stats.bytesDecoded << " decoded, round trip " << (same ? "equal (ok)" : "DIFFERS (MISMATCH)") << std::endl;
+    ok = ok && same;
+
+    // broken copies must be rejected without touching the grid that holds the good file
+    std::vector<char> bytes(fileSize);
+    file.seekg(0);
+    file.read(bytes.data(), std::streamsize(bytes.size()));
+    file.close();
+    const std::string brokenName = "check_grid_file_broken.plnx";
+    for(int broken = 0; broken < 2 && read; broken++)
+    {
+      std::vector<char> copy = bytes;
+      if(broken == 0)
+        copy.resize(copy.size() - 64);
+      else
+        std::memset(copy.data() + offsetof(GridFileHeader, version), 0, sizeof(uint32_t));
+      std::ofstream(brokenName, std::ios::binary).write(copy.data(), std::streamsize(copy.size()));
+
+      const bool accepted  = LoadGridFile(brokenName.c_str(), loaded);
+      const bool untouched = SamePlanes(loaded, source) && Render(loaded, res) == reference;
+      std::cout << "  " << (broken == 0 ? "truncated" : "version 0") << ": " << (accepted ? "ACCEPTED" : "rejected")
+                << (untouched ? ", grid untouched" : ", GRID CHANGED") << (!accepted && untouched ? " (ok)" : " (MISMATCH)") << std::endl;
+      ok = ok && !accepted && untouched;
+    }
+    std::remove(brokenName.c_str());
+    std::remove(fileName.c_str());
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "example_tracer/example_tracer.h"
+#include "example_tracer/tool_helpers.h"
+
+// renders the synthetic grid with LOD_FOOTPRINT from near and far orbits, with empty space skipping on and off; fails
+// (exit code 1) if the images differ at all, skipping must only leave out samples that add nothing. Registered with ctest.
+int main()
+{
+  const uint32_t gridSize = 128;
+  const uint32_t views    = 3;
+
+  RayMarcherExample renderer;
+  BuildSyntheticGrid(renderer, gridSize);
+  renderer.SetRenderThreads(0, 32);
+  renderer.SetWorldViewMProjatrix(perspectiveMatrix(45, 1, 0.1, 100));
+  renderer.SetLodPolicy(LOD_FOOTPRINT);
+
+  bool ok = true;
+  for(uint32_t res : {64u, 256u})
+  {
+    std::vector<uint32_t> skipped(size_t(res)*res), marched(size_t(res)*res);
+    for(float distance : {2.5f, 5.0f, 10.0f})
+    {
+      int worstDiff = 0;
+      for(uint32_t k = 0; k < views; k++)
+      {
+        renderer.SetWorldViewMatrix(OrbitView(k, views, distance));
+        renderer.SetEmptySpaceSkipping(true);
+        renderer.RayMarch(skipped.data(), res, res);
+        renderer.SetEmptySpaceSkipping(false);
+        renderer.RayMarch(marched.data(), res, res);
+        worstDiff = std::max(worstDiff, MaxChannelDiff(skipped, marched));
+      }
+      std::cout << res << "x" << res << ", distance " << distance << ": max channel diff of skipping on to off = " << worstDiff
+                << (worstDiff == 0 ? " (ok)" : " (MISMATCH)") << std::endl;
+      ok = ok && worstDiff == 0;
+    }
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "example_tracer/example_tracer.h"
+#include "example_tracer/tool_helpers.h"
+
+// renders a fixed synthetic grid with the scalar kernel and with every ray packet width the CPU supports; fails
+// (exit code 1) if any packet image differs from the scalar one by more than 1 in a channel. Registered with ctest.
+int main()
+{
+  const uint32_t gridSize = 64;
+  const uint32_t res      = 128;
+  const uint32_t views    = 3;
+
+  RayMarcherExample renderer;
+  BuildSyntheticGrid(renderer, gridSize);
+  renderer.SetRenderThreads(0, 32);
+  renderer.SetWorldViewMProjatrix(perspectiveMatrix(45, 1, 0.1, 100));
+
+  std::vector<std::vector<uint32_t> > scalar(views, std::vector<uint32_t>(size_t(res)*res));
+  renderer.SetRayPacketWidth(0);
+  for(uint32_t k = 0; k < views; k++)
+  {
+    renderer.SetWorldViewMatrix(OrbitView(k, views));
+    renderer.RayMarch(scalar[k].data(), res, res);
+  }
+
+  const uint32_t best = RayMarcherExample::BestRayPacketWidth();
+  bool ok = true;
+  std::vector<uint32_t> pixels(size_t(res)*res);
+  for(uint32_t width : {4u, 8u, 16u})
+  {
+    if(width > best)
+    {
+      std::cout << "packet width = " << width << ": skipped, the CPU runs at most " << best << std::endl;
+      continue;
+    }
+    renderer.SetRayPacketWidth(width);
+    int maxDiff = 0;
+    for(uint32_t k = 0; k < views; k++)
+    {
+      renderer.SetWorldViewMatrix(OrbitView(k, views));
+      renderer.RayMarch(pixels.data(), res, res);
+      maxDiff = std::max(maxDiff, MaxChannelDiff(pixels, scalar[k]));
+    }
+    std::cout << "packet width = " << width << ", max channel diff to scalar = " << maxDiff << (maxDiff <= 1 ? " (ok)" : " (MISMATCH)") << std::endl;
+    ok = ok && maxDiff <= 1;
+  }
+  return ok ? 0 : 1;
+}
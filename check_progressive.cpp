@@ -0,0 +1,67 @@
+#include <iostream>
+#include <vector>
+
+#include "example_tracer/example_tracer.h"
+#include "example_tracer/tool_helpers.h"
+
+// refines RayMarchProgressive frames of a fixed synthetic grid to the end, in one call and in many small budgets, on
+// one and several threads, with LOD off and on; the first view of every run is left half done before the camera moves.
+// Fails (exit code 1) if any finished frame differs at all from RayMarch with the scalar kernel. Registered with ctest.
+int main()
+{
+  const uint32_t gridSize = 64;
+  const uint32_t views    = 3;
+  const uint32_t sizes[2][2] = {{64, 64}, {100, 75}};
+
+  RayMarcherExample renderer;
+  BuildSyntheticGrid(renderer, gridSize);
+  renderer.SetWorldViewMProjatrix(perspectiveMatrix(45, 1, 0.1, 100));
+  renderer.SetRayPacketWidth(0);
+
+  bool ok = true;
+  for(uint32_t lod : {uint32_t(LOD_OFF), uint32_t(LOD_FOOTPRINT)})
+  {
+    renderer.SetLodPolicy(lod);
+    for(const auto& size : sizes)
+    {
+      const uint32_t width  = size[0];
+      const uint32_t height = size[1];
+      std::vector<std::vector<uint32_t> > full(views, std::vector<uint32_t>(size_t(width)*height));
+      renderer.SetRenderThreads(1, 0);
+      for(uint32_t k = 0; k < views; k++)
+      {
+        renderer.SetWorldViewMatrix(OrbitView(k, views));
+        renderer.RayMarch(full[k].data(), width, height);
+      }
+
+      std::vector<uint32_t> frame(size_t(width)*height);
+      for(uint32_t threads : {1u, 3u})
+      {
+        for(float budgetMs : {0.05f, 1000.0f})
+        {
+          renderer.SetRenderThreads(threads, 0);
+          renderer.SetWorldViewMatrix(OrbitView(views - 1, views));
+          renderer.ResetProgressive();
+          renderer.RayMarchProgressive(frame.data(), width, height, 0.0f);
+
+          size_t   differing = 0;
+          uint32_t calls     = 0;
+          for(uint32_t k = 0; k < views; k++)
+          {
+            renderer.SetWorldViewMatrix(OrbitView(k, views));
+            while(renderer.RayMarchProgressive(frame.data(), width, height, budgetMs) < 1.0f)
+              calls++;
+            calls++;
+            for(size_t i = 0; i < frame.size(); i++)
+              differing += (frame[i] != full[k][i]) ? 1 : 0;
+          }
+          std::cout << (lod == LOD_OFF ? "LOD off, " : "LOD on, ") << width << "x" << height << ", " << threads << " threads, budget "
+                    << budgetMs << " ms, " << calls << " calls: pixels differing from RayMarch = " << differing
+                    << (differing == 0 ? " (ok)" : " (MISMATCH)") << std::endl;
+          ok = ok && differing == 0;
+        }
+      }
+    }
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <vector>
+
+#include "example_tracer/example_tracer.h"
+#include "example_tracer/tool_helpers.h"
+
+// renders a fixed synthetic grid with the serial kernel2D_RayMarch and tiled on several thread counts and tile sizes,
+// including image sizes that no tile size divides; fails (exit code 1) if any tiled image or sample count differs at
+// all, tiling must not change a single pixel. Registered with ctest.
+int main()
+{
+  const uint32_t gridSize = 64;
+  const uint32_t views    = 3;
+  const uint32_t sizes[3][2] = {{64, 64}, {97, 61}, {33, 130}};
+
+  RayMarcherExample renderer;
+  BuildSyntheticGrid(renderer, gridSize);
+  renderer.SetWorldViewMProjatrix(perspectiveMatrix(45, 1, 0.1, 100));
+
+  bool ok = true;
+  for(const auto& size : sizes)
+  {
+    const uint32_t width  = size[0];
+    const uint32_t height = size[1];
+    std::vector<std::vector<uint32_t> > serial(views, std::vector<uint32_t>(size_t(width)*height));
+    std::vector<float> serialSamples(views);
+    renderer.SetRenderThreads(1, 0);
+    for(uint32_t k = 0; k < views; k++)
+    {
+      renderer.SetWorldViewMatrix(OrbitView(k, views));
+      renderer.RayMarch(serial[k].data(), width, height);
+      serialSamples[k] = renderer.GetSamplesPerRay();
+    }
+
+    std::vector<uint32_t> pixels(size_t(width)*height);
+    for(uint32_t threads : {1u, 2u, 5u})
+    {
+      size_t differing   = 0;
+      bool   samplesSame = true;
+      for(uint32_t tileSize : {1u, 7u, 32u, 256u})
+      {
+        renderer.SetRenderThreads(threads, tileSize);
+        for(uint32_t k = 0; k < views; k++)
+        {
+          renderer.SetWorldViewMatrix(OrbitView(k, views));
+          renderer.RayMarch(pixels.data(), width, height);
+          for(size_t i = 0; i < pixels.size(); i++)
+            differing += (pixels[i] != serial[k][i]) ? 1 : 0;
+          samplesSame = samplesSame && renderer.GetSamplesPerRay() == serialSamples[k];
+        }
+      }
+      std::cout << width << "x" << height << ", " << threads << " threads, tiles 1..256: pixels differing from serial = " << differing
+                << (samplesSame ? ", same samples" : ", other samples") << (differing == 0 && samplesSame ? " (ok)" : " (MISMATCH)") << std::endl;
+      ok = ok && differing == 0 && samplesSame;
+    }
+  }
+  return ok ? 0 : 1;
+}
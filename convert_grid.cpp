@@ -0,0 +1,72 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+#include "example_tracer/example_tracer.h"
+#include "example_tracer/grid_file.h"
+
+// converts a raw 'model.dat' (gridSize^3 Cell records, no header) to the grid file format of grid_file.h
+int main(int argc, const char** argv)
+{
+  if(argc < 3)
+  {
+    std::cout << "usage: convert_grid <model.dat> <out.plnx> [--size 128] [--sparse] [--bbox x0 y0 z0 x1 y1 z1]" << std::endl;
+    return 1;
+  }
+
+  size_t gridSize     = 128;
+  bool   sparseBricks = false;
+  float3 bbMin(0, 0, 0), bbMax(1, 1, 1);
+  for(int i = 3; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    if(arg == "--size" && i + 1 < argc)
+      gridSize = size_t(std::stoul(argv[++i]));
+    else if(arg == "--sparse")
+      sparseBricks = true;
+    else if(arg == "--bbox" && i + 6 < argc)
+    {
+      bbMin = float3(std::stof(argv[i+1]), std::stof(argv[i+2]), std::stof(argv[i+3]));
+      bbMax = float3(std::stof(argv[i+4]), std::stof(argv[i+5]), std::stof(argv[i+6]));
+      i += 6;
+    }
+  }
+
+  std::ifstream fin(argv[1], std::ios::in | std::ios::binary);
+  if(!fin)
+  {
+    std::cout << "can't open file '" << argv[1] << "'" << std::endl;
+    return 1;
+  }
+
+  RayMarcherExample grid;
+  grid.gridSize = gridSize;
+  grid.gridDensity.resize(gridSize*gridSize*gridSize);
+  grid.gridSH.resize(gridSize*gridSize*gridSize*SH_COEFFS);
+  grid.SetBoundingBox(bbMin, bbMax);
+
+  std::vector<Cell> cells(64*1024);
+  size_t first = 0;
+  while(first < grid.gridDensity.size() && fin)
+  {
+    const size_t count = std::min(cells.size(), grid.gridDensity.size() - first);
+    fin.read((char*)cells.data(), count * sizeof(Cell));
+    const size_t got = size_t(fin.gcount()) / sizeof(Cell);
+    grid.LoadCells(cells.data(), first, got);
+    first += got;
+  }
+
+  if(first != grid.gridDensity.size())
+  {
+    std::cout << "'" << argv[1] << "' has " << first << " cells, expected " << grid.gridDensity.size() << " for gridSize = " << gridSize << std::endl;
+    return 1;
+  }
+
+  if(!SaveGridFile(argv[2], grid, sparseBricks))
+    return 1;
+
+  std::cout << "wrote '" << argv[2] << "', gridSize = " << gridSize << (sparseBricks ? ", sparse bricks" : ", raw") << std::endl;
+  return 0;
+}
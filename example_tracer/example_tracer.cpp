@@ -1,6 +1,8 @@
 #include <vector>
 #include <chrono>
 #include <string>
+#include <cmath>
+#include <bitset>
 
 #include "example_tracer.h"
 
@@ -29,14 +31,14 @@ void sh_eval_2(const float3 &d, float *out) {
     out[4] = tmp_c * s1;
 }
 
-float eval_sh(float* sh, float3 rayDir) {
-  float sh_coeffs[SH_WIDTH];
-  sh_eval_2(rayDir, sh_coeffs);
-
-  float sum = 0.0f;
-  for (int i = 0; i < SH_WIDTH; i++)
-    sum += sh[i] * sh_coeffs[i];
-
+// sh layout: SH_WIDTH coefficients per channel, channels r, g, b one after another
+static inline float3 eval_sh(const float* sh, const float* shBasis) {
+  float3 sum(0.0f);
+  for (int i = 0; i < SH_WIDTH; i++) {
+    sum.x += sh[0*SH_WIDTH + i] * shBasis[i];
+    sum.y += sh[1*SH_WIDTH + i] * shBasis[i];
+    sum.z += sh[2*SH_WIDTH + i] * shBasis[i];
+  }
   return sum;
 }
 
@@ -84,23 +86,159 @@ static inline void transform_ray3f(float4x4 a_mWorldViewInv, float3* ray_pos, fl
   (*ray_dir) = to_float3(normalize(rayDirTransformed));
 }
 
-float4 RayMarchConstantFog(float tmin, float tmax, float& alpha)
+float RayMarcherExample::SampleDensity(float3 a_gridPos, uint32_t a_cells[8], float a_weights[8])
+{
+  const float  maxCoord = float(gridSize - 1);
+  const float3 p        = clamp(a_gridPos, float3(0.0f), float3(maxCoord));
+  const uint32_t x0     = std::min(uint32_t(p.x), uint32_t(gridSize - 2));
+  const uint32_t y0     = std::min(uint32_t(p.y), uint32_t(gridSize - 2));
+  const uint32_t z0     = std::min(uint32_t(p.z), uint32_t(gridSize - 2));
+  const float3   f      = p - float3(float(x0), float(y0), float(z0));
+
+  const uint32_t dy   = uint32_t(gridSize);
+  const uint32_t dz   = uint32_t(gridSize*gridSize);
+  const uint32_t base = x0 + y0*dy + z0*dz;
+
+  a_cells[0] = base;         a_weights[0] = (1.0f - f.x)*(1.0f - f.y)*(1.0f - f.z);
+  a_cells[1] = base + 1;     a_weights[1] = f.x         *(1.0f - f.y)*(1.0f - f.z);
+  a_cells[2] = base + dy;    a_weights[2] = (1.0f - f.x)*f.y         *(1.0f - f.z);
+  a_cells[3] = base + dy+1;  a_weights[3] = f.x         *f.y         *(1.0f - f.z);
+  a_cells[4] = base + dz;    a_weights[4] = (1.0f - f.x)*(1.0f - f.y)*f.z;
+  a_cells[5] = base + dz+1;  a_weights[5] = f.x         *(1.0f - f.y)*f.z;
+  a_cells[6] = base + dz+dy; a_weights[6] = (1.0f - f.x)*f.y         *f.z;
+  a_cells[7] = base+dz+dy+1; a_weights[7] = f.x         *f.y         *f.z;
+
+  #ifndef KERNEL_SLICER
+  if (m_profile)
+    for (int i = 0; i < 8; i++)
+      m_touchedDensity[a_cells[i] >> 5] |= 1u << (a_cells[i] & 31);
+  #endif
+
+  float density = 0.0f;
+  for (int i = 0; i < 8; i++)
+    density += a_weights[i]*gridDensity[a_cells[i]];
+  return density;
+}
+
+float3 RayMarcherExample::SampleColor(const uint32_t a_cells[8], const float a_weights[8], const float* a_shBasis)
+{
+  float3 color(0.0f);
+  #ifndef KERNEL_SLICER
+  if (m_profile)
+    for (int i = 0; i < 8; i++)
+      m_touchedSH[a_cells[i] >> 5] |= 1u << (a_cells[i] & 31);
+
+  if (shStorage != SH_STORAGE_FP32)
+  {
+    float sh[SH_COEFFS];
+    for (int i = 0; i < 8; i++)
+    {
+      DecodeSH(a_cells[i], sh);
+      color += a_weights[i]*eval_sh(sh, a_shBasis);
+    }
+    return max(color, float3(0.0f));
+  }
+  #endif
+  for (int i = 0; i < 8; i++)
+    color += a_weights[i]*eval_sh(gridSH.data() + size_t(a_cells[i])*SH_COEFFS, a_shBasis);
+  return max(color, float3(0.0f));
+}
+
+// returns the exit distance of the coarsest empty brick around a_gridPos, or -1 if all brick levels there are occupied
+float RayMarcherExample::EmptySpaceExit(float3 a_gridPos, float3 a_gridOrigin, float3 a_gridDir)
+{
+  for (int level = int(brickMipLevels) - 1; level >= 0; level--)
+  {
+    const uint32_t res  = brickMipRes[level];
+    const float    size = float(BRICK_SIZE << level);
+    const uint32_t bx   = std::min(uint32_t(std::max(a_gridPos.x / size, 0.0f)), res - 1);
+    const uint32_t by   = std::min(uint32_t(std::max(a_gridPos.y / size, 0.0f)), res - 1);
+    const uint32_t bz   = std::min(uint32_t(std::max(a_gridPos.z / size, 0.0f)), res - 1);
+    const uint32_t bit  = brickMipOffset[level] + bx + by*res + bz*res*res;
+    if ((brickMipBits[bit >> 5] >> (bit & 31)) & 1u)
+      continue;
+
+    // border bricks also own everything outside the grid because sample positions are clamped
+    const float3 lo = float3(bx == 0 ? -1e30f : float(bx)*size, by == 0 ? -1e30f : float(by)*size, bz == 0 ? -1e30f : float(bz)*size);
+    const float3 hi = float3(bx == res-1 ? 1e30f : float(bx+1)*size, by == res-1 ? 1e30f : float(by+1)*size, bz == res-1 ? 1e30f : float(bz+1)*size);
+
+    float tExit = 1e30f;
+    if (a_gridDir.x > 0.0f) tExit = std::min(tExit, (hi.x - a_gridOrigin.x) / a_gridDir.x);
+    if (a_gridDir.x < 0.0f) tExit = std::min(tExit, (lo.x - a_gridOrigin.x) / a_gridDir.x);
+    if (a_gridDir.y > 0.0f) tExit = std::min(tExit, (hi.y - a_gridOrigin.y) / a_gridDir.y);
+    if (a_gridDir.y < 0.0f) tExit = std::min(tExit, (lo.y - a_gridOrigin.y) / a_gridDir.y);
+    if (a_gridDir.z > 0.0f) tExit = std::min(tExit, (hi.z - a_gridOrigin.z) / a_gridDir.z);
+    if (a_gridDir.z < 0.0f) tExit = std::min(tExit, (lo.z - a_gridOrigin.z) / a_gridDir.z);
+    return tExit;
+  }
+  return -1.0f;
+}
+
+// returns true and moves *a_index to the next lattice sample that may be occupied if a_gridPos lies in empty space
+bool RayMarcherExample::SkipEmptySpace(float3 a_gridPos, float3 a_gridOrigin, float3 a_gridDir, float tmin, float tmax, float dt, uint32_t* a_index)
+{
+  const float tExit = EmptySpaceExit(a_gridPos, a_gridOrigin, a_gridDir);
+  if (tExit >= 0.0f)
+  {
+    const float next = std::ceil((std::min(tExit, tmax) - tmin)/dt - 0.5f);
+    (*a_index) = std::max((*a_index) + 1, uint32_t(std::max(next, 0.0f)));
+    return true;
+  }
+
+  const uint32_t N    = uint32_t(gridSize);
+  const uint32_t cx   = std::min(uint32_t(std::max(a_gridPos.x, 0.0f)), N - 2);
+  const uint32_t cy   = std::min(uint32_t(std::max(a_gridPos.y, 0.0f)), N - 2);
+  const uint32_t cz   = std::min(uint32_t(std::max(a_gridPos.z, 0.0f)), N - 2);
+  const uint32_t cell = cx + cy*N + cz*N*N;
+  if (((occupancyBits[cell >> 5] >> (cell & 31)) & 1u) == 0)
+  {
+    (*a_index)++;
+    return true;
+  }
+  return false;
+}
+
+float4 RayMarcherExample::RayMarchGrid(float3 rayPos, float3 rayDir, float tmin, float tmax, uint32_t* a_samples)
 {
-  float dt = 0.05f;
-	float t  = tmin;
-	
-	alpha = 1.0f;
-	float4 color = float4(0.0f);
-	
-	while(t < tmax && alpha > 0.01f)
-	{
-	  float a = 0.025f;
-	  color += a*alpha*float4(1.0f,1.0f,0.0f,0.0f);
-	  alpha *= (1.0f-a);
-	  t += dt;
-	}
-	
-	return color;
+  float shBasis[SH_WIDTH];
+  sh_eval_2(rayDir, shBasis);                                        // direction is fixed along the ray
+
+  const float3 boxSize     = bb.max - bb.min;
+  const float3 worldToGrid = float3(float(gridSize)) / boxSize;
+  const float3 gridOrigin  = (rayPos - bb.min)*worldToGrid - float3(0.5f);
+  const float3 gridDir     = rayDir*worldToGrid;
+  const float  dt          = STEP_SIZE_IN_CELLS * std::min(boxSize.x, std::min(boxSize.y, boxSize.z)) / float(gridSize);
+
+  float    transmittance = 1.0f;
+  float3   color(0.0f);
+  uint32_t samples = 0;
+
+  // samples stay on the lattice tmin + (i + 0.5)*dt, so skipping does not change the image
+  for (uint32_t i = 0; transmittance > MIN_TRANSMITTANCE; )
+  {
+    const float t = tmin + (float(i) + 0.5f)*dt;
+    if (t >= tmax)
+      break;
+
+    const float3 gridPos = gridOrigin + t*gridDir;
+    if (m_skipEmptySpace && SkipEmptySpace(gridPos, gridOrigin, gridDir, tmin, tmax, dt, &i))
+      continue;
+
+    uint32_t cells[8];
+    float    weights[8];
+    const float density = SampleDensity(gridPos, cells, weights);
+    const float alpha   = 1.0f - std::exp(-std::max(density, 0.0f)*dt);
+    samples++;
+    i++;
+    if (alpha < MIN_SAMPLE_ALPHA)
+      continue;
+
+    color         += (transmittance*alpha)*SampleColor(cells, weights, shBasis);
+    transmittance *= (1.0f - alpha);
+  }
+
+  (*a_samples) = samples;
+  return float4(std::min(color.x, 1.0f), std::min(color.y, 1.0f), std::min(color.z, 1.0f), 1.0f - transmittance);
 }
 
 static inline uint32_t RealColorToUint32(float4 real_color)
@@ -118,34 +256,298 @@ static inline uint32_t RealColorToUint32(float4 real_color)
   return red | (green << 8) | (blue << 16) | (alpha << 24);
 }
 
+// box intersection, marching and packing of a world space eye ray
+uint32_t RayMarcherExample::RayMarchEyeRay(float3 rayPos, float3 rayDir, uint32_t* a_samples)
+{
+  float2 tNearAndFar = RayBoxIntersection(rayPos, rayDir, bb.min, bb.max);
+  
+  float4 resColor(0.0f);
+  (*a_samples) = 0;
+  if(tNearAndFar.x < tNearAndFar.y && tNearAndFar.y > 0.0f)
+    resColor = RayMarchGrid(rayPos, rayDir, std::max(tNearAndFar.x, 0.0f), tNearAndFar.y, a_samples);
+  
+  return RealColorToUint32(resColor);
+}
+
+uint32_t RayMarcherExample::RayMarchPixel(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t* a_samples)
+{
+  float3 rayDir = EyeRayDir((float(x) + 0.5f) / float(width), (float(y) + 0.5f) / float(height), m_worldViewProjInv); 
+  float3 rayPos = float3(0.0f, 0.0f, 0.0f);
+
+  transform_ray3f(m_worldViewInv, &rayPos, &rayDir);
+  return RayMarchEyeRay(rayPos, rayDir, a_samples);
+}
+
+#ifndef KERNEL_SLICER
+// RayMarchPixel through a camera other than the current one (RayMarchBatch); a_coneAngle is used by LOD_FOOTPRINT
+uint32_t RayMarcherExample::RayMarchViewPixel(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const float4x4& a_worldViewProjInv,
+                                              const float4x4& a_worldViewInv, float a_coneAngle, uint32_t* a_samples)
+{
+  float3 rayDir = EyeRayDir((float(x) + 0.5f) / float(width), (float(y) + 0.5f) / float(height), a_worldViewProjInv);
+  float3 rayPos = float3(0.0f, 0.0f, 0.0f);
+
+  transform_ray3f(a_worldViewInv, &rayPos, &rayDir);
+  if (m_lodPolicy == LOD_OFF || m_lodLevels.empty())
+    return RayMarchEyeRay(rayPos, rayDir, a_samples);
+
+  float2 tNearAndFar = RayBoxIntersection(rayPos, rayDir, bb.min, bb.max);
+
+  float4 resColor(0.0f);
+  (*a_samples) = 0;
+  if(tNearAndFar.x < tNearAndFar.y && tNearAndFar.y > 0.0f)
+    resColor = RayMarchGridLod(rayPos, rayDir, std::max(tNearAndFar.x, 0.0f), tNearAndFar.y, a_coneAngle, a_samples);
+
+  return RealColorToUint32(resColor);
+}
+
+// angle between the eye rays of two vertically adjacent pixels at the image center
+float RayMarcherExample::PixelConeAngle(const float4x4& a_worldViewProjInv, uint32_t height)
+{
+  const float3 center = EyeRayDir(0.5f, 0.5f, a_worldViewProjInv);
+  const float3 next   = EyeRayDir(0.5f, 0.5f + 1.0f/float(height), a_worldViewProjInv);
+  return std::acos(std::min(dot(center, next), 1.0f));
+}
+
+float RayMarcherExample::SampleLodDensity(uint32_t a_level, float3 a_gridPos, uint32_t a_cells[8], float a_weights[8]) const
+{
+  const LodLevel& lod   = m_lodLevels[a_level - 1];
+  const uint32_t  N     = lod.size;
+  const float     scale = 1.0f/float(1u << a_level);
+  const float3    p     = clamp((a_gridPos + 0.5f)*scale - 0.5f, float3(0.0f), float3(float(N - 1)));
+  const uint32_t  x0    = std::min(uint32_t(p.x), N - 2);
+  const uint32_t  y0    = std::min(uint32_t(p.y), N - 2);
+  const uint32_t  z0    = std::min(uint32_t(p.z), N - 2);
+  const float3    f     = p - float3(float(x0), float(y0), float(z0));
+
+  const uint32_t base = x0 + y0*N + z0*N*N;
+  for (uint32_t i = 0; i < 8; i++)
+  {
+    a_cells[i]   = base + (i & 1) + ((i >> 1) & 1)*N + (i >> 2)*N*N;
+    a_weights[i] = ((i & 1) ? f.x : 1.0f - f.x)*(((i >> 1) & 1) ? f.y : 1.0f - f.y)*((i >> 2) ? f.z : 1.0f - f.z);
+  }
+
+  float density = 0.0f;
+  for (int i = 0; i < 8; i++)
+    density += a_weights[i]*lod.density[a_cells[i]];
+  return density;
+}
+
+float3 RayMarcherExample::SampleLodColor(uint32_t a_level, const uint32_t a_cells[8], const float a_weights[8], const float* a_shBasis) const
+{
+  const LodLevel& lod = m_lodLevels[a_level - 1];
+  float3 color(0.0f);
+  for (int i = 0; i < 8; i++)
+    color += a_weights[i]*eval_sh(lod.sh.data() + size_t(a_cells[i])*SH_COEFFS, a_shBasis);
+  return max(color, float3(0.0f));
+}
+
+// true if every level 0 cell a level a_level sample at a_gridPos reads from is empty, looked up in the brick mip
+bool RayMarcherExample::LodSampleEmpty(uint32_t a_level, float3 a_gridPos) const
+{
+  const uint32_t N      = uint32_t(gridSize);
+  const uint32_t coarse = m_lodLevels[a_level - 1].size;
+  const float3   p      = clamp((a_gridPos + 0.5f)/float(1u << a_level) - 0.5f, float3(0.0f), float3(float(coarse - 1)));
+  const uint3    c0     = uint3(std::min(uint32_t(p.x), coarse - 2), std::min(uint32_t(p.y), coarse - 2), std::min(uint32_t(p.z), coarse - 2));
+
+  // coarse cells c0 and c0 + 1 average the level 0 cells [c0*2^k, (c0 + 2)*2^k), found in the occupancy footprints
+  // based at the same cells (clamped to N - 2, whose footprint holds the last cell)
+  const uint3 lo = uint3(std::min(c0.x << a_level, N - 2), std::min(c0.y << a_level, N - 2), std::min(c0.z << a_level, N - 2));
+  const uint3 hi = uint3(std::min(((c0.x + 2) << a_level) - 1, N - 2), std::min(((c0.y + 2) << a_level) - 1, N - 2),
+                         std::min(((c0.z + 2) << a_level) - 1, N - 2));
+
+  // the finest brick level with bricks at least as large as the range, so it overlaps at most 2x2x2 of them
+  const uint32_t extent = std::max(hi.x - lo.x, std::max(hi.y - lo.y, hi.z - lo.z)) + 1;
+  uint32_t level = 0;
+  while (level + 1 < brickMipLevels && (BRICK_SIZE << level) < extent)
+    level++;
+  const uint32_t size = BRICK_SIZE << level;
+  const uint32_t res  = brickMipRes[level];
+  for (uint32_t bz = lo.z / size; bz <= hi.z / size; bz++)
+    for (uint32_t by = lo.y / size; by <= hi.y / size; by++)
+      for (uint32_t bx = lo.x / size; bx <= hi.x / size; bx++)
+      {
+        const uint32_t bit = brickMipOffset[level] + bx + by*res + bz*res*res;
+        if ((brickMipBits[bit >> 5] >> (bit & 31)) & 1u)
+          return false;
+      }
+  return true;
+}
+
+// RayMarchGrid on the LOD pyramid: the lattice index stays in level 0 steps, a level k sample covers 2^k of them and
+// sits in their middle, so rays that never leave level 0 take exactly the samples of RayMarchGrid
+float4 RayMarcherExample::RayMarchGridLod(float3 rayPos, float3 rayDir, float tmin, float tmax, float a_coneAngle, uint32_t* a_samples)
+{
+  float shBasis[SH_WIDTH];
+  sh_eval_2(rayDir, shBasis);
+
+  const float3 boxSize     = bb.max - bb.min;
+  const float3 worldToGrid = float3(float(gridSize)) / boxSize;
+  const float3 gridOrigin  = (rayPos - bb.min)*worldToGrid - float3(0.5f);
+  const float3 gridDir     = rayDir*worldToGrid;
+  const float  dt          = STEP_SIZE_IN_CELLS * std::min(boxSize.x, std::min(boxSize.y, boxSize.z)) / float(gridSize);
+  const float  coneCells   = a_coneAngle*STEP_SIZE_IN_CELLS/dt; // cone width in cells per unit of distance
+  const uint32_t maxLevel  = uint32_t(m_lodLevels.size());
+
+  float    transmittance = 1.0f;
+  float3   color(0.0f);
+  uint32_t samples = 0;
+
+  // the footprint at the start of a span picks its level, rayPos is the eye so t is the distance to it
+  auto levelAt = [&](uint32_t a_index)
+  {
+    const float lodLevel = std::log2(std::max((tmin + float(a_index)*dt)*coneCells, 1e-6f)) + m_lodBias;
+    return (lodLevel < 1.0f) ? 0u : std::min(uint32_t(lodLevel), maxLevel);
+  };
+
+  // skipping never moves the spans: level 0 jumps stop at the first coarse span and coarse spans are skipped whole,
+  // so the image is the one without skipping
+  for (uint32_t i = 0; transmittance > MIN_TRANSMITTANCE; )
+  {
+    const uint32_t level = levelAt(i);
+    if (tmin + (float(i) + 0.5f)*dt >= tmax)
+      break;
+
+    // the last span is clamped to the level 0 steps RayMarchGrid would still take before tmax
+    uint32_t span = 1u << level;
+    while (span > 1 && tmin + (float(i + span) - 0.5f)*dt >= tmax)
+      span--;
+    const float3 gridPos = gridOrigin + (tmin + (float(i) + 0.5f*float(span))*dt)*gridDir;
+
+    if (m_skipEmptySpace && level == 0)
+    {
+      const uint32_t from = i;
+      if (SkipEmptySpace(gridPos, gridOrigin, gridDir, tmin, tmax, dt, &i))
+      {
+        if (levelAt(i) > 0)
+        {
+          uint32_t lo = from + 1;              // the first index of a coarse level in (from, i]
+          while (lo < i)
+          {
+            const uint32_t mid = lo + (i - lo)/2;
+            if (levelAt(mid) > 0) i = mid; else lo = mid + 1;
+          }
+        }
+        continue;
+      }
+    }
+    else if (m_skipEmptySpace && LodSampleEmpty(level, gridPos))
+    {
+      i += span;
+      continue;
+    }
+
+    uint32_t cells[8];
+    float    weights[8];
+    const float density = (level == 0) ? SampleDensity(gridPos, cells, weights) : SampleLodDensity(level, gridPos, cells, weights);
+    const float alpha   = 1.0f - std::exp(-std::max(density, 0.0f)*dt*float(span));
+    samples++;
+    i += span;
+    if (alpha < MIN_SAMPLE_ALPHA)
+      continue;
+
+    const float3 sampleColor = (level == 0) ? SampleColor(cells, weights, shBasis) : SampleLodColor(level, cells, weights, shBasis);
+    color         += (transmittance*alpha)*sampleColor;
+    transmittance *= (1.0f - alpha);
+  }
+
+  (*a_samples) = samples;
+  return float4(std::min(color.x, 1.0f), std::min(color.y, 1.0f), std::min(color.z, 1.0f), 1.0f - transmittance);
+}
+#endif
+
+#ifndef KERNEL_SLICER
+// RayMarchPixel with a clock read between its stages
+uint32_t RayMarcherExample::RayMarchPixelProfiled(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t* a_samples)
+{
+  typedef std::chrono::high_resolution_clock clock;
+  const auto setupStart = clock::now();
+
+  float3 rayDir = EyeRayDir((float(x) + 0.5f) / float(width), (float(y) + 0.5f) / float(height), m_worldViewProjInv);
+  float3 rayPos = float3(0.0f, 0.0f, 0.0f);
+  transform_ray3f(m_worldViewInv, &rayPos, &rayDir);
+  const auto boxStart = clock::now();
+
+  float2 tNearAndFar = RayBoxIntersection(rayPos, rayDir, bb.min, bb.max);
+  const auto marchStart = clock::now();
+
+  float4 resColor(0.0f);
+  (*a_samples) = 0;
+  if(tNearAndFar.x < tNearAndFar.y && tNearAndFar.y > 0.0f)
+    resColor = RayMarchGrid(rayPos, rayDir, std::max(tNearAndFar.x, 0.0f), tNearAndFar.y, a_samples);
+  const auto packStart = clock::now();
+
+  const uint32_t packed = RealColorToUint32(resColor);
+  const auto packEnd = clock::now();
+
+  m_stageNs[0] += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(boxStart   - setupStart).count());
+  m_stageNs[1] += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(marchStart - boxStart).count());
+  m_stageNs[2] += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(packStart  - marchStart).count());
+  m_stageNs[3] += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(packEnd    - packStart).count());
+  return packed;
+}
+
+void RayMarcherExample::RayMarchProfiled(uint32_t* out_color, uint32_t width, uint32_t height)
+{
+  const size_t words = (gridDensity.size() + 31)/32;
+  m_touchedDensity.assign(words, 0u);
+  m_touchedSH.assign(words, 0u);
+  std::fill(m_stageNs, m_stageNs + 4, uint64_t(0));
+
+  for(uint32_t y=0;y<height;y++)
+  {
+    for(uint32_t x=0;x<width;x++)
+    {
+      uint32_t samples = 0;
+      out_color[y*width+x] = RayMarchPixelProfiled(x, y, width, height, &samples);
+      m_samplesTaken += samples;
+    }
+  }
+}
+
+// distinct cells read by the last profiled frame times their bytes in the current storage (Q8 brick tables included)
+size_t RayMarcherExample::GetTouchedGridBytes() const
+{
+  size_t densityCells = 0, shCells = 0;
+  for (uint32_t bits : m_touchedDensity)
+    densityCells += std::bitset<32>(bits).count();
+  for (uint32_t bits : m_touchedSH)
+    shCells += std::bitset<32>(bits).count();
+  const size_t cells = std::max(gridDensity.size(), size_t(1));
+  return densityCells*sizeof(float) + size_t(double(shCells)*double(GetSHBytes())/double(cells));
+}
+#endif
+
 void RayMarcherExample::kernel2D_RayMarch(uint32_t* out_color, uint32_t width, uint32_t height) 
 {
+  uint64_t samplesTaken = 0;
   for(uint32_t y=0;y<height;y++) 
   {
     for(uint32_t x=0;x<width;x++) 
     {
-      float3 rayDir = EyeRayDir((float(x) + 0.5f) / float(width), (float(y) + 0.5f) / float(height), m_worldViewProjInv); 
-      float3 rayPos = float3(0.0f, 0.0f, 0.0f);
-
-      transform_ray3f(m_worldViewInv, &rayPos, &rayDir);
-      
-      float2 tNearAndFar = RayBoxIntersection(rayPos, rayDir, bb.min, bb.max);
-      
-      float4 resColor(0.0f);
-      if(tNearAndFar.x < tNearAndFar.y && tNearAndFar.x > 0.0f)
-      {
-        float alpha = 1.0f;
-	      resColor = RayMarchConstantFog(tNearAndFar.x, tNearAndFar.y, alpha);
-      }
-      
-      out_color[y*width+x] = RealColorToUint32(resColor);
+      uint32_t samples = 0;
+      out_color[y*width+x] = RayMarchPixel(x, y, width, height, &samples);
+      samplesTaken += samples;
     }
   }
+  m_samplesTaken += samplesTaken;
 }
 
 void RayMarcherExample::RayMarch(uint32_t* out_color, uint32_t width, uint32_t height)
 { 
+  m_samplesTaken = 0;
+  m_raysTraced   = uint64_t(width)*uint64_t(height);
   auto start = std::chrono::high_resolution_clock::now();
+  #ifndef KERNEL_SLICER
+  if(m_lodPolicy != LOD_OFF && m_lodLevels.empty())
+    BuildLodPyramid();
+  if(m_profile)
+    RayMarchProfiled(out_color, width, height);
+  else if(m_pool != nullptr && m_tileSize != 0)
+    RayMarchTiled(out_color, width, height);
+  else if(m_packetWidth != 0 || m_lodPolicy != LOD_OFF)
+    m_samplesTaken += RayMarchBlock(out_color, width, height, 0, 0, width, height, m_worldViewProjInv, m_worldViewInv);
+  else
+  #endif
   kernel2D_RayMarch(out_color, width, height);
   rayMarchTime = float(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count())/1000.f;
 }  
@@ -154,4 +556,9 @@ void RayMarcherExample::GetExecutionTime(const char* a_funcName, float a_out[4])
 {
   if(std::string(a_funcName) == "RayMarch")
     a_out[0] =  rayMarchTime;
+  #ifndef KERNEL_SLICER
+  else if(std::string(a_funcName) == "RayMarchStages")
+    for(int i = 0; i < 4; i++)
+      a_out[i] = float(double(m_stageNs[i])*1e-6);
+  #endif
 }
@@ -4,12 +4,20 @@
 #include <iostream>
 #include <fstream>
 #include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include <functional>
 
 #include "LiteMath.h"
 using namespace LiteMath;
 
-const size_t SH_WIDTH = 9;
+#include "grid_plane.h"
 
+const size_t SH_WIDTH  = 9;
+const size_t SH_COEFFS = 3*SH_WIDTH; // r, g, b planes of SH_WIDTH each
+
+// AoS layout of the 'model.dat' files; the renderer keeps grid in SoA planes (see LoadCells)
 struct Cell {
   float density;
   float sh_r[SH_WIDTH];
@@ -17,6 +25,23 @@ struct Cell {
   float sh_b[SH_WIDTH];
 };
 
+const float STEP_SIZE_IN_CELLS = 0.5f;   // marching step relative to the cell size
+const float MIN_SAMPLE_ALPHA   = 1e-4f;  // samples with lower opacity are skipped without touching SH
+const float MIN_TRANSMITTANCE  = 1e-3f;  // stop marching when the ray is almost fully occluded
+
+const uint32_t BRICK_SIZE         = 8;  // cells per side of the finest occupancy brick
+const uint32_t MAX_BRICK_LEVELS   = 16;
+const uint32_t MAX_LOD_LEVELS     = 8;  // coarser copies of the grid in the level of detail pyramid, see SetLodPolicy
+
+// how gridSH is kept in memory, see SetSHStorage
+enum SH_STORAGE { SH_STORAGE_FP32 = 0, SH_STORAGE_FP16 = 1, SH_STORAGE_Q8 = 2 };
+
+// how the marcher picks the grid resolution along a ray, see SetLodPolicy
+enum LOD_POLICY { LOD_OFF = 0, LOD_FOOTPRINT = 1 };
+
+class WorkStealingPool;
+class GridTrainer;
+
 struct BoundingBox {
   float3 min;
   float3 max;
@@ -34,16 +59,30 @@ public:
     m_worldViewProjInv  = inverse4x4(proj); 
   }
 
-    void InitGrid(const float _gridSize) {
+  void InitGrid(const size_t _gridSize) {
     gridSize = _gridSize;
-    grid.resize(gridSize * gridSize * gridSize);
+    gridDensity.assign(gridSize * gridSize * gridSize, 0.01f);
+    gridSH.assign(gridSize * gridSize * gridSize * SH_COEFFS, 0.1f);
+    #ifndef KERNEL_SLICER
+    gridSHHalf    = {};
+    gridSHQ8      = {};
+    shBrickScale  = {};
+    shBrickOffset = {};
+    shStorage     = SH_STORAGE_FP32;
+    #endif
+    RebuildOccupancy();
+  }
 
-    for (size_t i = 0; i < gridSize * gridSize * gridSize; i++) {
-      grid[i].density = 0.01;
+  // scatter AoS cells [a_first, a_first + a_count) into density and SH planes; SH must be in SH_STORAGE_FP32
+  void LoadCells(const Cell* a_cells, size_t a_first, size_t a_count) {
+    for (size_t i = 0; i < a_count; i++) {
+      const Cell& cell = a_cells[i];
+      float* sh = gridSH.data() + (a_first + i) * SH_COEFFS;
+      gridDensity[a_first + i] = cell.density;
       for (size_t j = 0; j < SH_WIDTH; j++) {
-        grid[i].sh_r[j] = 0.1;
-        grid[i].sh_g[j] = 0.1;
-        grid[i].sh_b[j] = 0.1;
+        sh[0*SH_WIDTH + j] = cell.sh_r[j];
+        sh[1*SH_WIDTH + j] = cell.sh_g[j];
+        sh[2*SH_WIDTH + j] = cell.sh_b[j];
       }
     }
   }
@@ -53,6 +92,79 @@ public:
     bb.max = boxMax;
   }
 
+  // occupancy must be rebuilt after grid data changes, otherwise edited cells may be skipped
+  void RebuildOccupancy();
+  void UpdateOccupancy(uint3 a_cellMin, uint3 a_cellMax); // only cells in [a_cellMin, a_cellMax] were edited
+  void SetOccupancyThreshold(float a_density) { occupancyThreshold = a_density; RebuildOccupancy(); }
+  void SetEmptySpaceSkipping(bool a_enable)   { m_skipEmptySpace = a_enable; }
+  float GetSamplesPerRay() const { return m_raysTraced == 0 ? 0.0f : float(double(m_samplesTaken)/double(m_raysTraced)); }
+
+  // CPU only: render a_tileSize x a_tileSize tiles on a_threads workers (0 = all cores); a_tileSize = 0 returns to the serial kernel
+  void SetRenderThreads(uint32_t a_threads, uint32_t a_tileSize = 32);
+
+  // CPU only: march 4 (SSE), 8 (AVX2) or 16 (AVX-512) rays of a row together, 0 -- scalar kernel; capped at BestRayPacketWidth()
+  void SetRayPacketWidth(uint32_t a_width);
+  static uint32_t BestRayPacketWidth();
+
+  #ifndef KERNEL_SLICER
+  // CPU only: re-encode SH to SH_STORAGE_FP32, FP16 or Q8 (scale/offset per brick and coefficient); density stays fp32
+  void     SetSHStorage(uint32_t a_storage);
+  uint32_t GetSHStorage() const { return shStorage; }
+  size_t   GetSHBytes()   const;
+
+  // CPU only: serial scalar frames with per stage times (GetExecutionTime("RayMarchStages")) and touched grid bytes
+  void   SetRayMarchProfiling(bool a_enable) { m_profile = a_enable; }
+  size_t GetTouchedGridBytes() const;
+
+  // CPU only: LOD_FOOTPRINT samples a 2x box filtered pyramid at level log2(pixel cone / cell size) + a_bias
+  void     SetLodPolicy(uint32_t a_policy, float a_bias = 0.0f) { m_lodPolicy = a_policy; m_lodBias = a_bias; }
+  uint32_t GetLodPolicy() const { return m_lodPolicy; }
+  void     BuildLodPyramid();
+  size_t   GetLodBytes() const;
+
+  // CPU only: 8x8 blocks first, then refines the same out_color within a_budgetMs per call; returns the fraction traced
+  float RayMarchProgressive(uint32_t* out_color, uint32_t width, uint32_t height, float a_budgetMs);
+  void  ResetProgressive() { m_progressive.next = 0; m_progressive.target = nullptr; }
+
+  // CPU only: render a_count views in one pool run; a_onViewDone(i) is called by the worker that finishes view i
+  void RayMarchBatch(const float4x4* a_worldView, const float4x4* a_proj, uint32_t* const* a_outColor, uint32_t a_count,
+                     uint32_t width, uint32_t height, const std::function<void(uint32_t)>& a_onViewDone = nullptr);
+
+  // SH_COEFFS values of one cell in any storage
+  void DecodeSH(uint32_t a_cell, float* a_sh) const
+  {
+    if (shStorage == SH_STORAGE_FP16)
+    {
+      // exponent rebias by a multiply instead of half.hpp's table lookup: exact for finite halves and vectorizes
+      const uint16_t* src = gridSHHalf.data() + size_t(a_cell)*SH_COEFFS;
+      for (size_t i = 0; i < SH_COEFFS; i++)
+      {
+        const uint32_t bits = (uint32_t(src[i] & 0x8000) << 16) | (uint32_t(src[i] & 0x7FFF) << 13);
+        float value;
+        std::memcpy(&value, &bits, sizeof(float));
+        a_sh[i] = value*0x1p112f;
+      }
+    }
+    else if (shStorage == SH_STORAGE_Q8)
+    {
+      const uint32_t N     = uint32_t(gridSize);
+      const uint32_t bx    = (a_cell % N) / BRICK_SIZE;
+      const uint32_t by    = ((a_cell / N) % N) / BRICK_SIZE;
+      const uint32_t bz    = (a_cell / (N*N)) / BRICK_SIZE;
+      const size_t   brick = size_t(bx + by*shBrickRes + bz*shBrickRes*shBrickRes)*SH_COEFFS;
+      const uint8_t* src   = gridSHQ8.data() + size_t(a_cell)*SH_COEFFS;
+      for (size_t i = 0; i < SH_COEFFS; i++)
+        a_sh[i] = shBrickOffset[brick + i] + float(src[i])*shBrickScale[brick + i];
+    }
+    else
+    {
+      const float* src = gridSH.data() + size_t(a_cell)*SH_COEFFS;
+      for (size_t i = 0; i < SH_COEFFS; i++)
+        a_sh[i] = src[i];
+    }
+  }
+  #endif
+
   void SetWorldViewMProjatrix(const float4x4& a_mat) {m_worldViewProjInv = inverse4x4(a_mat);}
   void SetWorldViewMatrix(const float4x4& a_mat) {m_worldViewInv = inverse4x4(a_mat);}
 
@@ -65,13 +177,92 @@ public:
   //virtual void UpdateMembersTexureData() {}                              // will be overriden in generated class (optional function)
   virtual void GetExecutionTime(const char* a_funcName, float a_out[4]);   // will be overriden in generated class
 
-  std::vector<Cell> grid;
+  GridPlane<float> gridDensity; // gridSize^3,           cell (x,y,z) at x + y*gridSize + z*gridSize^2
+  GridPlane<float> gridSH;      // gridSize^3*SH_COEFFS, same order, SH_COEFFS floats per cell; may view a mapped grid file
+  #ifndef KERNEL_SLICER
+  GridPlane<uint16_t>         gridSHHalf;    // SH_STORAGE_FP16: IEEE half bits in gridSH order, empty in other modes
+  GridPlane<uint8_t>          gridSHQ8;      // SH_STORAGE_Q8: gridSH order, value = offset + q*scale of the cell's brick
+  GridPlane<float>            shBrickScale;  // SH_STORAGE_Q8: SH_COEFFS per brick, bricks at bx + by*shBrickRes + bz*shBrickRes^2
+  GridPlane<float>            shBrickOffset;
+  uint32_t                    shBrickRes = 0;
+  uint32_t                    shStorage  = SH_STORAGE_FP32;
+  #endif
   size_t gridSize;
   BoundingBox bb;
 
+  std::vector<uint32_t> occupancyBits; // bit per cell (x,y,z): any of the 8 cells sampled between (x,y,z) and (x+1,y+1,z+1) is occupied
+  std::vector<uint32_t> brickMipBits;  // all levels of the brick mip, BRICK_SIZE^3 cells per brick at level 0, 2x coarser per next level
+  uint32_t brickMipOffset[MAX_BRICK_LEVELS]; // first bit of each level in brickMipBits
+  uint32_t brickMipRes[MAX_BRICK_LEVELS];    // bricks per side of each level
+  uint32_t brickMipLevels = 0;
+  float    occupancyThreshold = 0.0f;        // cells with density <= threshold are treated as empty
+
 protected:
 
+  uint32_t RayMarchPixel(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t* a_samples);
+  uint32_t RayMarchEyeRay(float3 rayPos, float3 rayDir, uint32_t* a_samples);
+  #ifndef KERNEL_SLICER
+  uint32_t RayMarchViewPixel(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const float4x4& a_worldViewProjInv,
+                             const float4x4& a_worldViewInv, float a_coneAngle, uint32_t* a_samples);
+  float4   RayMarchGridLod(float3 rayPos, float3 rayDir, float tmin, float tmax, float a_coneAngle, uint32_t* a_samples);
+  bool     LodSampleEmpty(uint32_t a_level, float3 a_gridPos) const;
+  float    SampleLodDensity(uint32_t a_level, float3 a_gridPos, uint32_t a_cells[8], float a_weights[8]) const;
+  float3   SampleLodColor(uint32_t a_level, const uint32_t a_cells[8], const float a_weights[8], const float* a_shBasis) const;
+  static float PixelConeAngle(const float4x4& a_worldViewProjInv, uint32_t height);
+  uint32_t RayMarchPixelProfiled(uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t* a_samples);
+  void     RayMarchProfiled(uint32_t* out_color, uint32_t width, uint32_t height);
+  #endif
+  float4 RayMarchGrid(float3 rayPos, float3 rayDir, float tmin, float tmax, uint32_t* a_samples);
+  float  EmptySpaceExit(float3 a_gridPos, float3 a_gridOrigin, float3 a_gridDir);
+  bool   SkipEmptySpace(float3 a_gridPos, float3 a_gridOrigin, float3 a_gridDir, float tmin, float tmax, float dt, uint32_t* a_index);
+  float  SampleDensity(float3 a_gridPos, uint32_t a_cells[8], float a_weights[8]);
+  float3 SampleColor(const uint32_t a_cells[8], const float a_weights[8], const float* a_shBasis);
+
   float4x4 m_worldViewProjInv;
   float4x4 m_worldViewInv;
   float    rayMarchTime;
+  bool     m_skipEmptySpace = true;
+  uint64_t m_samplesTaken   = 0;
+  uint64_t m_raysTraced     = 0;
+
+  #ifndef KERNEL_SLICER
+  friend class GridTrainer; // marches training rays with the protected sampling functions
+
+  void     RayMarchTiled(uint32_t* out_color, uint32_t width, uint32_t height);
+  uint64_t RayMarchBlock(uint32_t* out_color, uint32_t width, uint32_t height, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+                         const float4x4& a_worldViewProjInv, const float4x4& a_worldViewInv);
+
+  std::shared_ptr<WorkStealingPool> m_pool;
+  uint32_t                          m_tileSize    = 0;
+  uint32_t                          m_packetWidth = 0;
+  std::vector<uint64_t>             m_tileSamples;
+
+  bool                              m_profile     = false;
+  uint64_t                          m_stageNs[4]  = {};   // ray setup, box intersection, marching, pixel packing
+  std::vector<uint32_t>             m_touchedDensity;     // bit per cell, cells read by the last profiled frame
+  std::vector<uint32_t>             m_touchedSH;
+
+  struct LodLevel
+  {
+    uint32_t           size;    // cells per side, cell (x,y,z) averages cells 2x..2x+1 (clamped) of the finer level
+    std::vector<float> density;
+    std::vector<float> sh;      // SH_COEFFS per cell
+  };
+  uint32_t                          m_lodPolicy   = LOD_OFF;
+  float                             m_lodBias     = 0.0f;
+  std::vector<LodLevel>             m_lodLevels;          // levels 1, 2, ...; level 0 is the grid itself
+
+  struct ProgressiveState
+  {
+    std::vector<uint32_t> order;          // pixel indices, one level of block size 8, 4, 2, 1 after another
+    size_t                levelEnd[4];    // end of each level in order
+    size_t                next   = 0;     // first pixel of order that is not traced yet
+    const uint32_t*       target = nullptr;
+    uint32_t              width  = 0;
+    uint32_t              height = 0;
+    float4x4              worldViewInv;
+    float4x4              worldViewProjInv;
+  };
+  ProgressiveState                  m_progressive;
+  #endif
 };
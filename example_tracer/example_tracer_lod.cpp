@@ -0,0 +1,70 @@
+#include <algorithm>
+
+#include "example_tracer.h"
+
+// Every level averages 2x2x2 cells of the finer one (fewer at odd borders). Density is averaged linearly, which keeps
+// the optical depth of a coarse step equal to the mean of the fine steps it replaces; SH is averaged as well, so a
+// coarse sample has the mean color of its cells rather than their opacity weighted color.
+
+void RayMarcherExample::BuildLodPyramid()
+{
+  m_lodLevels.clear();
+  if (gridSize < 8)
+    return;
+
+  float sh[SH_COEFFS];
+  uint32_t fineSize = uint32_t(gridSize);
+  while (m_lodLevels.size() < MAX_LOD_LEVELS && fineSize >= 8)
+  {
+    const LodLevel* fine = m_lodLevels.empty() ? nullptr : &m_lodLevels.back();
+    LodLevel level;
+    level.size = (fineSize + 1) / 2;
+    const uint32_t N = level.size;
+    level.density.assign(size_t(N)*N*N, 0.0f);
+    level.sh.assign(size_t(N)*N*N*SH_COEFFS, 0.0f);
+
+    for (uint32_t z = 0; z < N; z++)
+      for (uint32_t y = 0; y < N; y++)
+        for (uint32_t x = 0; x < N; x++)
+        {
+          const size_t cell  = x + y*size_t(N) + z*size_t(N)*N;
+          float*       dst   = level.sh.data() + cell*SH_COEFFS;
+          uint32_t     count = 0;
+          for (uint32_t fz = 2*z; fz < std::min(2*z + 2, fineSize); fz++)
+            for (uint32_t fy = 2*y; fy < std::min(2*y + 2, fineSize); fy++)
+              for (uint32_t fx = 2*x; fx < std::min(2*x + 2, fineSize); fx++)
+              {
+                const size_t src = fx + fy*size_t(fineSize) + fz*size_t(fineSize)*fineSize;
+                const float* srcSH = sh;
+                if (fine == nullptr)
+                {
+                  level.density[cell] += gridDensity[src];
+                  DecodeSH(uint32_t(src), sh);
+                }
+                else
+                {
+                  level.density[cell] += fine->density[src];
+                  srcSH = fine->sh.data() + src*SH_COEFFS;
+                }
+                for (size_t i = 0; i < SH_COEFFS; i++)
+                  dst[i] += srcSH[i];
+                count++;
+              }
+
+          level.density[cell] /= float(count);
+          for (size_t i = 0; i < SH_COEFFS; i++)
+            dst[i] /= float(count);
+        }
+
+    m_lodLevels.push_back(std::move(level));
+    fineSize = N;
+  }
+}
+
+size_t RayMarcherExample::GetLodBytes() const
+{
+  size_t bytes = 0;
+  for (const auto& level : m_lodLevels)
+    bytes += (level.density.size() + level.sh.size())*sizeof(float);
+  return bytes;
+}
@@ -0,0 +1,114 @@
+#include <algorithm>
+
+#include "example_tracer.h"
+
+static inline void SetBit(std::vector<uint32_t>& bits, size_t i, bool val)
+{
+  if (val) bits[i >> 5] |=  (1u << (i & 31));
+  else     bits[i >> 5] &= ~(1u << (i & 31));
+}
+
+static inline bool GetBit(const std::vector<uint32_t>& bits, size_t i) { return (bits[i >> 5] >> (i & 31)) & 1u; }
+
+void RayMarcherExample::RebuildOccupancy()
+{
+  if (gridSize < 2)
+    return;
+
+  // cells are addressed by the min corner of the trilinear footprint, so only [0, gridSize-2] are ever looked up
+  const uint32_t cells = uint32_t(gridSize - 1);
+
+  brickMipLevels = 0;
+  uint32_t totalBits = 0;
+  for (uint32_t size = BRICK_SIZE; brickMipLevels < MAX_BRICK_LEVELS; size *= 2)
+  {
+    const uint32_t res = (cells + size - 1) / size;
+    brickMipOffset[brickMipLevels] = totalBits;
+    brickMipRes   [brickMipLevels] = res;
+    totalBits += res*res*res;
+    brickMipLevels++;
+    if (res == 1)
+      break;
+  }
+
+  occupancyBits.assign((gridSize*gridSize*gridSize + 31) / 32, 0u);
+  brickMipBits.assign((totalBits + 31) / 32, 0u);
+
+  UpdateOccupancy(uint3(0, 0, 0), uint3(cells, cells, cells));
+}
+
+void RayMarcherExample::UpdateOccupancy(uint3 a_cellMin, uint3 a_cellMax)
+{
+  m_lodLevels.clear(); // the pyramid is rebuilt from the edited grid by the next RayMarch that needs it
+  ResetProgressive();
+  if (gridSize < 2 || brickMipLevels == 0)
+    return;
+
+  const uint32_t N    = uint32_t(gridSize);
+  const uint32_t last = N - 2;
+
+  // an edited cell is a trilinear corner of its own footprint and of the footprints based one cell lower
+  uint3 lo = uint3(a_cellMin.x == 0 ? 0 : a_cellMin.x - 1, a_cellMin.y == 0 ? 0 : a_cellMin.y - 1, a_cellMin.z == 0 ? 0 : a_cellMin.z - 1);
+  uint3 hi = uint3(std::min(a_cellMax.x, last), std::min(a_cellMax.y, last), std::min(a_cellMax.z, last));
+  if (lo.x > hi.x || lo.y > hi.y || lo.z > hi.z)
+    return;
+
+  for (uint32_t z = lo.z; z <= hi.z; z++)
+  {
+    for (uint32_t y = lo.y; y <= hi.y; y++)
+    {
+      for (uint32_t x = lo.x; x <= hi.x; x++)
+      {
+        const size_t base = size_t(x) + size_t(y)*N + size_t(z)*N*N;
+        bool occupied = false;
+        for (uint32_t c = 0; c < 8 && !occupied; c++)
+        {
+          const size_t cell = base + (c & 1) + ((c >> 1) & 1)*N + (c >> 2)*size_t(N)*N;
+          occupied = gridDensity[cell] > occupancyThreshold;
+        }
+        SetBit(occupancyBits, base, occupied);
+      }
+    }
+  }
+
+  // level 0 bricks are reduced from cells, every next level from 2x2x2 bricks of the previous one
+  for (uint32_t level = 0; level < brickMipLevels; level++)
+  {
+    const uint32_t size = BRICK_SIZE << level;
+    const uint32_t res  = brickMipRes[level];
+    const uint3 bMin = uint3(lo.x / size, lo.y / size, lo.z / size);
+    const uint3 bMax = uint3(hi.x / size, hi.y / size, hi.z / size);
+
+    for (uint32_t bz = bMin.z; bz <= bMax.z; bz++)
+    {
+      for (uint32_t by = bMin.y; by <= bMax.y; by++)
+      {
+        for (uint32_t bx = bMin.x; bx <= bMax.x; bx++)
+        {
+          bool occupied = false;
+          if (level == 0)
+          {
+            const uint32_t x1 = std::min(bx*size + size - 1, last);
+            const uint32_t y1 = std::min(by*size + size - 1, last);
+            const uint32_t z1 = std::min(bz*size + size - 1, last);
+            for (uint32_t z = bz*size; z <= z1 && !occupied; z++)
+              for (uint32_t y = by*size; y <= y1 && !occupied; y++)
+                for (uint32_t x = bx*size; x <= x1 && !occupied; x++)
+                  occupied = GetBit(occupancyBits, size_t(x) + size_t(y)*N + size_t(z)*N*N);
+          }
+          else
+          {
+            const uint32_t prevRes = brickMipRes[level - 1];
+            for (uint32_t c = 0; c < 8 && !occupied; c++)
+            {
+              const uint32_t cx = 2*bx + (c & 1), cy = 2*by + ((c >> 1) & 1), cz = 2*bz + (c >> 2);
+              if (cx < prevRes && cy < prevRes && cz < prevRes)
+                occupied = GetBit(brickMipBits, brickMipOffset[level - 1] + cx + cy*prevRes + cz*prevRes*prevRes);
+            }
+          }
+          SetBit(brickMipBits, brickMipOffset[level] + bx + by*res + bz*res*res, occupied);
+        }
+      }
+    }
+  }
+}
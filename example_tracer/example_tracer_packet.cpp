@@ -0,0 +1,445 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "example_tracer.h"
+
+// Ray packet version of RayMarchPixel/RayMarchGrid. LiteMath's VEX layer only has 4-wide types, so packets are written
+// in the same gcc/clang vector extensions as VEX/vfloat4_gcc.h, templated on the width and compiled once per ISA
+// through target attributes; BestRayPacketWidth() picks the widest one the CPU runs. Lanes that left the box,
+// became opaque or lie past the end of the row are masked out, the scalar kernel stays the reference.
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PACKETS_SUPPORTED 1
+#pragma GCC diagnostic ignored "-Wpsabi"
+#define PACKET_INLINE inline __attribute__((always_inline))
+#endif
+
+#if defined(PACKETS_SUPPORTED) && (defined(__x86_64__) || defined(__i386__))
+#define PACKETS_X86 1
+#endif
+
+#ifdef PACKETS_SUPPORTED
+namespace
+{
+  struct PacketScene
+  {
+    float    viewProjInv[16]; // column major, as float4x4
+    float    viewInv[16];
+    float    bbMin[3];
+    float    bbMax[3];
+    uint32_t gridSize;
+    bool     skipEmptySpace;
+
+    const float*    density;
+    const float*    sh;             // null if SH is not fp32, cells are decoded through grid then
+    const RayMarcherExample* grid;
+    const uint32_t* occupancyBits;
+    const uint32_t* brickMipBits;
+    const uint32_t* brickMipOffset;
+    const uint32_t* brickMipRes;
+    uint32_t        brickMipLevels;
+  };
+
+  template<int W> struct Packet
+  {
+    typedef float   vf __attribute__((vector_size(4*W)));
+    typedef int32_t vi __attribute__((vector_size(4*W)));
+  };
+
+  template<typename V> PACKET_INLINE V    vmin(V a, V b) { return b < a ? b : a; } // same operand order as std::min
+  template<typename V> PACKET_INLINE V    vmax(V a, V b) { return a < b ? b : a; } // same operand order as std::max
+  template<typename M> PACKET_INLINE bool any(M a_mask, int W)
+  {
+    for (int l = 0; l < W; l++)
+      if (a_mask[l] != 0)
+        return true;
+    return false;
+  }
+
+  template<typename V> PACKET_INLINE V vsqrt(V a, int W)
+  {
+    for (int l = 0; l < W; l++)
+      a[l] = std::sqrt(a[l]);
+    return a;
+  }
+
+  // exp(x) for x <= 0 via Cephes-style range reduction, relative error ~1e-7
+  template<int W> PACKET_INLINE typename Packet<W>::vf vexp(typename Packet<W>::vf x)
+  {
+    typedef typename Packet<W>::vf vf;
+    typedef typename Packet<W>::vi vi;
+    x = vmax<vf>(x, vf{} - 87.0f);
+    vf n = x*1.44269504088896341f + 0.5f;
+    vi k = __builtin_convertvector(n, vi);
+    k = (__builtin_convertvector(k, vf) > n) ? k - 1 : k;                 // floor for negative values
+    const vf fk = __builtin_convertvector(k, vf);
+    x = x - fk*0.693359375f + fk*2.12194440e-4f;
+
+    vf p = vf{} + 1.9875691500e-4f;
+    p = p*x + 1.3981999507e-3f;
+    p = p*x + 8.3334519073e-3f;
+    p = p*x + 4.1665795894e-2f;
+    p = p*x + 1.6666665459e-1f;
+    p = p*x + 5.0000001201e-1f;
+    p = p*x*x + x + 1.0f;
+
+    const vi scale = (k + 127) << 23;
+    vf res;
+    std::memcpy(&res, &scale, sizeof(res));
+    return p*res;
+  }
+
+  template<int W> PACKET_INLINE typename Packet<W>::vf gather(const float* a_base, typename Packet<W>::vi a_idx, typename Packet<W>::vi a_mask)
+  {
+    typename Packet<W>::vf res = {};
+    for (int l = 0; l < W; l++)
+      res[l] = a_mask[l] ? a_base[uint32_t(a_idx[l])] : 0.0f;
+    return res;
+  }
+
+  template<int W> PACKET_INLINE typename Packet<W>::vi testBits(const uint32_t* a_bits, typename Packet<W>::vi a_idx, typename Packet<W>::vi a_mask)
+  {
+    typename Packet<W>::vi res = {};
+    for (int l = 0; l < W; l++)
+    {
+      const uint32_t bit = uint32_t(a_idx[l]);
+      res[l] = (a_mask[l] && ((a_bits[bit >> 5] >> (bit & 31)) & 1u)) ? -1 : 0;
+    }
+    return res;
+  }
+
+  template<int W>
+  PACKET_INLINE uint64_t MarchPacket(const PacketScene& s, uint32_t x0, uint32_t y, uint32_t count, uint32_t width, uint32_t height, uint32_t* out)
+  {
+    typedef typename Packet<W>::vf vf;
+    typedef typename Packet<W>::vi vi;
+
+    vf lane;
+    for (int l = 0; l < W; l++)
+      lane[l] = float(l);
+    const vi inRow = lane < float(count);
+
+    // EyeRayDir
+    const float* P  = s.viewProjInv;
+    const vf     px = 2.0f*((float(x0) + lane + 0.5f) / float(width)) - 1.0f;
+    const float  py = 2.0f*((float(y) + 0.5f) / float(height)) - 1.0f;
+    vf ex = px*P[0] + py*P[4] + P[12];
+    vf ey = px*P[1] + py*P[5] + P[13];
+    vf ez = px*P[2] + py*P[6] + P[14];
+    vf ew = px*P[3] + py*P[7] + P[15];
+    ex = ex/ew; ey = ey/ew; ez = ez/ew;
+    vf lenInv = 1.0f/vsqrt(ex*ex + ey*ey + ez*ez, W);
+    ex *= lenInv; ey *= lenInv; ez *= lenInv;
+
+    // transform_ray3f
+    const float* V  = s.viewInv;
+    const float  ox = V[12], oy = V[13], oz = V[14];
+    vf dx = ex*V[0] + ey*V[4] + ez*V[8];
+    vf dy = ex*V[1] + ey*V[5] + ez*V[9];
+    vf dz = ex*V[2] + ey*V[6] + ez*V[10];
+    vf dw = ex*V[3] + ey*V[7] + ez*V[11];
+    lenInv = 1.0f/vsqrt(dx*dx + dy*dy + dz*dz + dw*dw, W);
+    dx *= lenInv; dy *= lenInv; dz *= lenInv;
+
+    // RayBoxIntersection
+    const vf ix = 1.0f/dx, iy = 1.0f/dy, iz = 1.0f/dz;
+    vf lo = ix*(s.bbMin[0] - ox), hi = ix*(s.bbMax[0] - ox);
+    vf tmin = vmin(lo, hi), tmax = vmax(lo, hi);
+    lo = iy*(s.bbMin[1] - oy); hi = iy*(s.bbMax[1] - oy);
+    tmin = vmax(tmin, vmin(lo, hi)); tmax = vmin(tmax, vmax(lo, hi));
+    lo = iz*(s.bbMin[2] - oz); hi = iz*(s.bbMax[2] - oz);
+    tmin = vmax(tmin, vmin(lo, hi)); tmax = vmin(tmax, vmax(lo, hi));
+
+    const vi hit = inRow & (tmin < tmax) & (tmax > 0.0f);
+    tmin = vmax(tmin, vf{});
+
+    // sh_eval_2, once per ray
+    vf basis[SH_WIDTH];
+    {
+      const vf z2 = dz*dz;
+      const vf c1 = dx*dx - dy*dy;
+      const vf s1 = dx*dy + dy*dx;
+      basis[0] = vf{} + 0.28209479177387814f;
+      basis[2] = dz*0.488602511902919923f;
+      basis[6] = z2*0.94617469575756008f + -0.315391565252520045f;
+      basis[3] = -0.488602511902919978f*dx;
+      basis[1] = -0.488602511902919978f*dy;
+      basis[7] = (dz*-1.09254843059207896f)*dx;
+      basis[5] = (dz*-1.09254843059207896f)*dy;
+      basis[8] = 0.546274215296039478f*c1;
+      basis[4] = 0.546274215296039478f*s1;
+    }
+
+    const uint32_t N    = s.gridSize;
+    const float    bsx  = s.bbMax[0] - s.bbMin[0], bsy = s.bbMax[1] - s.bbMin[1], bsz = s.bbMax[2] - s.bbMin[2];
+    const float    w2gx = float(N)/bsx, w2gy = float(N)/bsy, w2gz = float(N)/bsz;
+    const float    dt   = STEP_SIZE_IN_CELLS * std::min(bsx, std::min(bsy, bsz)) / float(N);
+    const float    maxCoord = float(N - 1);
+    const vi       lastCell = vi{} + int32_t(N - 2);
+
+    const float gox = (ox - s.bbMin[0])*w2gx - 0.5f, goy = (oy - s.bbMin[1])*w2gy - 0.5f, goz = (oz - s.bbMin[2])*w2gz - 0.5f;
+    const vf    gdx = dx*w2gx, gdy = dy*w2gy, gdz = dz*w2gz;
+
+    vf transmittance = vf{} + 1.0f;
+    vf cr = {}, cg = {}, cb = {};
+    vf index = {};
+    vi samples = {};
+
+    while (true)
+    {
+      const vf t      = tmin + (index + 0.5f)*dt;
+      const vi active = hit & (transmittance > MIN_TRANSMITTANCE) & (t < tmax);
+      if (!any(active, W))
+        break;
+
+      const vf gx = gox + t*gdx, gy = goy + t*gdy, gz = goz + t*gdz;
+      vi sampleMask = active;
+
+      if (s.skipEmptySpace)
+      {
+        // EmptySpaceExit for all lanes, coarsest level first
+        vi found = {};
+        vf tExit = {};
+        for (int level = int(s.brickMipLevels) - 1; level >= 0; level--)
+        {
+          const vi pending = active & ~found;
+          if (!any(pending, W))
+            break;
+
+          const int32_t res  = int32_t(s.brickMipRes[level]);
+          const float   size = float(BRICK_SIZE << level);
+          const vi bx = vmin<vi>(__builtin_convertvector(vmax<vf>(gx/size, vf{}), vi), vi{} + (res - 1));
+          const vi by = vmin<vi>(__builtin_convertvector(vmax<vf>(gy/size, vf{}), vi), vi{} + (res - 1));
+          const vi bz = vmin<vi>(__builtin_convertvector(vmax<vf>(gz/size, vf{}), vi), vi{} + (res - 1));
+          const vi bit = int32_t(s.brickMipOffset[level]) + bx + by*res + bz*res*res;
+          const vi empty = pending & ~testBits<W>(s.brickMipBits, bit, pending);
+          if (!any(empty, W))
+            continue;
+
+          const vf fbx = __builtin_convertvector(bx, vf), fby = __builtin_convertvector(by, vf), fbz = __builtin_convertvector(bz, vf);
+          const vf lx = (bx == 0) ? vf{} - 1e30f : fbx*size, hx = (bx == res - 1) ? vf{} + 1e30f : (fbx + 1.0f)*size;
+          const vf ly = (by == 0) ? vf{} - 1e30f : fby*size, hy = (by == res - 1) ? vf{} + 1e30f : (fby + 1.0f)*size;
+          const vf lz = (bz == 0) ? vf{} - 1e30f : fbz*size, hz = (bz == res - 1) ? vf{} + 1e30f : (fbz + 1.0f)*size;
+
+          vf te = vf{} + 1e30f;
+          te = (gdx > 0.0f) ? vmin(te, (hx - gox)/gdx) : te;
+          te = (gdx < 0.0f) ? vmin(te, (lx - gox)/gdx) : te;
+          te = (gdy > 0.0f) ? vmin(te, (hy - goy)/gdy) : te;
+          te = (gdy < 0.0f) ? vmin(te, (ly - goy)/gdy) : te;
+          te = (gdz > 0.0f) ? vmin(te, (hz - goz)/gdz) : te;
+          te = (gdz < 0.0f) ? vmin(te, (lz - goz)/gdz) : te;
+
+          tExit = empty ? te : tExit;
+          found = found | empty;
+        }
+
+        vf next = (vmin(tExit, tmax) - tmin)/dt - 0.5f;
+        for (int l = 0; l < W; l++)
+          next[l] = std::ceil(next[l]);
+        index = found ? vmax(index + 1.0f, vmax(next, vf{})) : index;
+
+        const vi pending = active & ~found;
+        const vi cx = vmin<vi>(__builtin_convertvector(vmax<vf>(gx, vf{}), vi), lastCell);
+        const vi cy = vmin<vi>(__builtin_convertvector(vmax<vf>(gy, vf{}), vi), lastCell);
+        const vi cz = vmin<vi>(__builtin_convertvector(vmax<vf>(gz, vf{}), vi), lastCell);
+        const vi occupied = testBits<W>(s.occupancyBits, cx + cy*int32_t(N) + cz*int32_t(N*N), pending);
+        index      = (pending & ~occupied) ? index + 1.0f : index;
+        sampleMask = pending & occupied;
+        if (!any(sampleMask, W))
+          continue;
+      }
+
+      // SampleDensity
+      const vf px0 = vmax<vf>(vmin<vf>(gx, vf{} + maxCoord), vf{});
+      const vf py0 = vmax<vf>(vmin<vf>(gy, vf{} + maxCoord), vf{});
+      const vf pz0 = vmax<vf>(vmin<vf>(gz, vf{} + maxCoord), vf{});
+      const vi x0i = vmin<vi>(__builtin_convertvector(px0, vi), lastCell);
+      const vi y0i = vmin<vi>(__builtin_convertvector(py0, vi), lastCell);
+      const vi z0i = vmin<vi>(__builtin_convertvector(pz0, vi), lastCell);
+      const vf fx  = px0 - __builtin_convertvector(x0i, vf);
+      const vf fy  = py0 - __builtin_convertvector(y0i, vf);
+      const vf fz  = pz0 - __builtin_convertvector(z0i, vf);
+
+      const int32_t sy = int32_t(N), sz = int32_t(N*N);
+      const vi base = x0i + y0i*sy + z0i*sz;
+      vi cells[8]   = {base, base + 1, base + sy, base + sy + 1, base + sz, base + sz + 1, base + sz + sy, base + sz + sy + 1};
+      vf weights[8] = {(1.0f - fx)*(1.0f - fy)*(1.0f - fz), fx*(1.0f - fy)*(1.0f - fz),
+                       (1.0f - fx)*fy*(1.0f - fz),          fx*fy*(1.0f - fz),
+                       (1.0f - fx)*(1.0f - fy)*fz,          fx*(1.0f - fy)*fz,
+                       (1.0f - fx)*fy*fz,                   fx*fy*fz};
+
+      vf density = {};
+      for (int i = 0; i < 8; i++)
+        density += weights[i]*gather<W>(s.density, cells[i], sampleMask);
+
+      const vf alpha = 1.0f - vexp<W>(-vmax(density, vf{})*dt);
+      samples -= sampleMask;
+      index    = sampleMask ? index + 1.0f : index;
+
+      const vi contributes = sampleMask & (alpha >= MIN_SAMPLE_ALPHA);
+      if (!any(contributes, W))
+        continue;
+
+      // SampleColor; contributing lanes are usually sparse (surfaces are thin), so SH is read lane by lane
+      vf r = {}, g = {}, b = {};
+      for (int l = 0; l < W; l++)
+      {
+        if (!contributes[l])
+          continue;
+        float basisL[SH_WIDTH];
+        for (int k = 0; k < int(SH_WIDTH); k++)
+          basisL[k] = basis[k][l];
+
+        float sr = 0.0f, sg = 0.0f, sb = 0.0f;
+        float decoded[SH_COEFFS];
+        for (int i = 0; i < 8; i++)
+        {
+          const float* sh = decoded;
+          if (s.sh != nullptr)
+            sh = s.sh + size_t(uint32_t(cells[i][l]))*SH_COEFFS;
+          else
+            s.grid->DecodeSH(uint32_t(cells[i][l]), decoded);
+          float er = 0.0f, eg = 0.0f, eb = 0.0f;
+          for (int k = 0; k < int(SH_WIDTH); k++)
+          {
+            er += sh[0*SH_WIDTH + k]*basisL[k];
+            eg += sh[1*SH_WIDTH + k]*basisL[k];
+            eb += sh[2*SH_WIDTH + k]*basisL[k];
+          }
+          sr += weights[i][l]*er;
+          sg += weights[i][l]*eg;
+          sb += weights[i][l]*eb;
+        }
+        r[l] = std::max(sr, 0.0f);
+        g[l] = std::max(sg, 0.0f);
+        b[l] = std::max(sb, 0.0f);
+      }
+
+      const vf weight = transmittance*alpha;
+      cr = contributes ? cr + weight*r : cr;
+      cg = contributes ? cg + weight*g : cg;
+      cb = contributes ? cb + weight*b : cb;
+      transmittance = contributes ? transmittance*(1.0f - alpha) : transmittance;
+    }
+
+    // RealColorToUint32
+    const vf one = vf{} + 1.0f;
+    const vi red   = __builtin_convertvector(vmin(cr, one)*255.0f, vi);
+    const vi green = __builtin_convertvector(vmin(cg, one)*255.0f, vi);
+    const vi blue  = __builtin_convertvector(vmin(cb, one)*255.0f, vi);
+    const vi alpha = hit ? __builtin_convertvector((1.0f - transmittance)*255.0f, vi) : vi{};
+
+    uint64_t samplesTaken = 0;
+    for (uint32_t l = 0; l < count; l++)
+    {
+      out[l] = uint32_t(red[l]) | (uint32_t(green[l]) << 8) | (uint32_t(blue[l]) << 16) | (uint32_t(alpha[l]) << 24);
+      samplesTaken += uint32_t(samples[l]);
+    }
+    return samplesTaken;
+  }
+
+  template<int W>
+  PACKET_INLINE uint64_t MarchBlock(const PacketScene& s, uint32_t* out_color, uint32_t width, uint32_t height, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+  {
+    uint64_t samplesTaken = 0;
+    for (uint32_t y = y0; y < y1; y++)
+      for (uint32_t x = x0; x < x1; x += W)
+        samplesTaken += MarchPacket<W>(s, x, y, std::min(uint32_t(W), x1 - x), width, height, out_color + y*width + x);
+    return samplesTaken;
+  }
+
+  #ifdef PACKETS_X86
+  __attribute__((target("avx512f,avx2,fma")))
+  uint64_t MarchBlockAVX512(const PacketScene& s, uint32_t* out, uint32_t w, uint32_t h, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) { return MarchBlock<16>(s, out, w, h, x0, y0, x1, y1); }
+
+  __attribute__((target("avx2,fma")))
+  uint64_t MarchBlockAVX2(const PacketScene& s, uint32_t* out, uint32_t w, uint32_t h, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) { return MarchBlock<8>(s, out, w, h, x0, y0, x1, y1); }
+
+  __attribute__((target("sse4.1")))
+  uint64_t MarchBlockSSE(const PacketScene& s, uint32_t* out, uint32_t w, uint32_t h, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) { return MarchBlock<4>(s, out, w, h, x0, y0, x1, y1); }
+  #else
+  uint64_t MarchBlockSSE(const PacketScene& s, uint32_t* out, uint32_t w, uint32_t h, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) { return MarchBlock<4>(s, out, w, h, x0, y0, x1, y1); }
+  #endif
+}
+#endif
+
+uint32_t RayMarcherExample::BestRayPacketWidth()
+{
+  #if defined(PACKETS_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return 16;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return 8;
+  if (__builtin_cpu_supports("sse4.1"))
+    return 4;
+  return 0;
+  #elif defined(PACKETS_SUPPORTED)
+  return 4;
+  #else
+  return 0;
+  #endif
+}
+
+void RayMarcherExample::SetRayPacketWidth(uint32_t a_width)
+{
+  const uint32_t best = BestRayPacketWidth();
+  if (a_width == 0 || best == 0)
+    m_packetWidth = 0;
+  else if (a_width >= 16)
+    m_packetWidth = std::min(16u, best);
+  else if (a_width >= 8)
+    m_packetWidth = std::min(8u, best);
+  else
+    m_packetWidth = 4;
+}
+
+uint64_t RayMarcherExample::RayMarchBlock(uint32_t* out_color, uint32_t width, uint32_t height, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+                                          const float4x4& a_worldViewProjInv, const float4x4& a_worldViewInv)
+{
+  #ifdef PACKETS_SUPPORTED
+  if (m_packetWidth != 0 && gridSize >= 2 && m_lodPolicy == LOD_OFF)
+  {
+    PacketScene scene;
+    std::memcpy(scene.viewProjInv, &a_worldViewProjInv, sizeof(scene.viewProjInv));
+    std::memcpy(scene.viewInv,     &a_worldViewInv,     sizeof(scene.viewInv));
+    for (int i = 0; i < 3; i++)
+    {
+      scene.bbMin[i] = bb.min[i];
+      scene.bbMax[i] = bb.max[i];
+    }
+    scene.gridSize       = uint32_t(gridSize);
+    scene.skipEmptySpace = m_skipEmptySpace;
+    scene.density        = gridDensity.data();
+    scene.sh             = (shStorage == SH_STORAGE_FP32) ? gridSH.data() : nullptr;
+    scene.grid           = this;
+    scene.occupancyBits  = occupancyBits.data();
+    scene.brickMipBits   = brickMipBits.data();
+    scene.brickMipOffset = brickMipOffset;
+    scene.brickMipRes    = brickMipRes;
+    scene.brickMipLevels = brickMipLevels;
+
+    #ifdef PACKETS_X86
+    if (m_packetWidth == 16)
+      return MarchBlockAVX512(scene, out_color, width, height, x0, y0, x1, y1);
+    if (m_packetWidth == 8)
+      return MarchBlockAVX2(scene, out_color, width, height, x0, y0, x1, y1);
+    #endif
+    return MarchBlockSSE(scene, out_color, width, height, x0, y0, x1, y1);
+  }
+  #endif
+
+  const float coneAngle = (m_lodPolicy == LOD_OFF) ? 0.0f : PixelConeAngle(a_worldViewProjInv, height);
+  uint64_t samplesTaken = 0;
+  for (uint32_t y = y0; y < y1; y++)
+  {
+    for (uint32_t x = x0; x < x1; x++)
+    {
+      uint32_t samples = 0;
+      out_color[y*width + x] = RayMarchViewPixel(x, y, width, height, a_worldViewProjInv, a_worldViewInv, coneAngle, &samples);
+      samplesTaken += samples;
+    }
+  }
+  return samplesTaken;
+}
@@ -0,0 +1,137 @@
+#include <chrono>
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "example_tracer.h"
+#include "work_stealing_pool.h"
+
+// block sizes of the progressive levels: level 0 traces the top left pixel of every 8x8 block, each next level the
+// pixels that are new on a 2x finer lattice, and every traced pixel paints its block until finer pixels overwrite it
+static const uint32_t PROGRESSIVE_BLOCK[4] = {8, 4, 2, 1};
+static const uint32_t PROGRESSIVE_TILE     = 32; // multiple of the largest block
+static const size_t   PROGRESSIVE_GROUP    = 16; // pixels a worker claims at once, the clock is read between groups
+
+static uint32_t ReverseBits(uint32_t a_value)
+{
+  a_value = ((a_value >> 1) & 0x55555555u) | ((a_value & 0x55555555u) << 1);
+  a_value = ((a_value >> 2) & 0x33333333u) | ((a_value & 0x33333333u) << 2);
+  a_value = ((a_value >> 4) & 0x0F0F0F0Fu) | ((a_value & 0x0F0F0F0Fu) << 4);
+  a_value = ((a_value >> 8) & 0x00FF00FFu) | ((a_value & 0x00FF00FFu) << 8);
+  return (a_value >> 16) | (a_value << 16);
+}
+
+float RayMarcherExample::RayMarchProgressive(uint32_t* out_color, uint32_t width, uint32_t height, float a_budgetMs)
+{
+  typedef std::chrono::high_resolution_clock clock;
+  const auto start = clock::now();
+  ProgressiveState& state = m_progressive;
+
+  const bool sameFrame = state.target == out_color && state.width == width && state.height == height &&
+                         std::memcmp(&state.worldViewInv,     &m_worldViewInv,     sizeof(float4x4)) == 0 &&
+                         std::memcmp(&state.worldViewProjInv, &m_worldViewProjInv, sizeof(float4x4)) == 0;
+  if (!sameFrame)
+  {
+    if (state.width != width || state.height != height || state.order.empty())
+    {
+      state.order.clear();
+      state.order.reserve(size_t(width)*height);
+      // a level visits 32x32 tiles in bit reversed order, so that any run of the order is spread over the whole
+      // image (the refinement stops evenly when the budget runs out, and a chunk costs about the average), while the
+      // rays within a tile are neighbours that share grid cells in cache
+      const uint32_t tilesX = (width  + PROGRESSIVE_TILE - 1) / PROGRESSIVE_TILE;
+      const uint32_t tilesY = (height + PROGRESSIVE_TILE - 1) / PROGRESSIVE_TILE;
+      std::vector<uint32_t> tiles(tilesX*tilesY);
+      for (uint32_t tile = 0; tile < tiles.size(); tile++)
+        tiles[tile] = tile;
+      std::sort(tiles.begin(), tiles.end(), [](uint32_t a, uint32_t b) { return ReverseBits(a) < ReverseBits(b); });
+
+      for (uint32_t level = 0; level < 4; level++)
+      {
+        const uint32_t block = PROGRESSIVE_BLOCK[level];
+        for (uint32_t tile : tiles)
+        {
+          const uint32_t x0 = (tile % tilesX)*PROGRESSIVE_TILE;
+          const uint32_t y0 = (tile / tilesX)*PROGRESSIVE_TILE;
+          for (uint32_t y = y0; y < std::min(y0 + PROGRESSIVE_TILE, height); y += block)
+            for (uint32_t x = x0; x < std::min(x0 + PROGRESSIVE_TILE, width); x += block)
+              if (level == 0 || x % (2*block) != 0 || y % (2*block) != 0)
+                state.order.push_back(y*width + x);
+        }
+        state.levelEnd[level] = state.order.size();
+      }
+    }
+    state.next             = 0;
+    state.target           = out_color;
+    state.width            = width;
+    state.height           = height;
+    state.worldViewInv     = m_worldViewInv;
+    state.worldViewProjInv = m_worldViewProjInv;
+  }
+
+  m_samplesTaken = 0;
+  m_raysTraced   = 0;
+  const size_t total = state.order.size();
+  if (m_lodPolicy != LOD_OFF && m_lodLevels.empty())
+    BuildLodPyramid();
+  const float coneAngle = (m_lodPolicy == LOD_OFF) ? 0.0f : PixelConeAngle(m_worldViewProjInv, height);
+
+  // every worker claims the next group of the order until the deadline, checked before each claim; the coarse level
+  // is finished whatever the budget. Claimed groups are always traced, so the traced pixels stay a prefix of the order.
+  // Blocks of one level are disjoint but a coarse block covers finer pixels, so each level is its own pool run and
+  // no block is painted while a finer pixel under it may already be traced
+  const uint32_t threads  = (m_pool != nullptr) ? m_pool->ThreadCount() : 1;
+  const auto     deadline = start + std::chrono::microseconds(int64_t(double(a_budgetMs)*1000.0));
+  const size_t   first    = state.next;
+  m_tileSamples.assign(threads, 0);
+  for (uint32_t level = 0; level < 4 && state.next < total; level++)
+  {
+    const size_t levelEnd = state.levelEnd[level];
+    if (state.next >= levelEnd)
+      continue;
+    if (level > 0 && clock::now() >= deadline)
+      break;
+
+    const uint32_t block = PROGRESSIVE_BLOCK[level];
+    std::atomic<size_t> cursor(state.next);
+    auto trace = [&](uint32_t task, uint32_t)
+    {
+      uint64_t samplesTaken = 0;
+      while (true)
+      {
+        if (level > 0 && clock::now() >= deadline)
+          break;
+        const size_t begin = cursor.fetch_add(PROGRESSIVE_GROUP);
+        if (begin >= levelEnd)
+          break;
+        for (size_t i = begin; i < std::min(begin + PROGRESSIVE_GROUP, levelEnd); i++)
+        {
+          const uint32_t x = state.order[i] % width;
+          const uint32_t y = state.order[i] / width;
+          uint32_t samples = 0;
+          const uint32_t color = RayMarchViewPixel(x, y, width, height, state.worldViewProjInv, state.worldViewInv, coneAngle, &samples);
+          samplesTaken += samples;
+
+          for (uint32_t by = y; by < std::min(y + block, height); by++)
+            for (uint32_t bx = x; bx < std::min(x + block, width); bx++)
+              out_color[by*width + bx] = color;
+        }
+      }
+      m_tileSamples[task] += samplesTaken;
+    };
+
+    if (m_pool != nullptr)
+      m_pool->Run(threads, trace);
+    else
+      trace(0, 0);
+    state.next = std::min(cursor.load(), levelEnd);
+  }
+
+  for (uint64_t samples : m_tileSamples)
+    m_samplesTaken += samples;
+  m_raysTraced = state.next - first;
+
+  rayMarchTime = float(std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count())/1000.f;
+  return total == 0 ? 1.0f : float(double(state.next)/double(total));
+}
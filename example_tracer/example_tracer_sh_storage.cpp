@@ -0,0 +1,121 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "example_tracer.h"
+#include "half.hpp"
+
+static_assert(sizeof(half_float::half) == sizeof(uint16_t), "gridSHHalf stores the bits of half_float::half");
+
+// Re-encoding reads the old storage cell by cell through DecodeSH and writes the new planes directly, so the peak
+// is the old plus the new storage, never an extra fp32 copy of the grid.
+
+void RayMarcherExample::SetSHStorage(uint32_t a_storage)
+{
+  if (a_storage > SH_STORAGE_Q8)
+  {
+    std::cout << "[SetSHStorage]: unknown storage " << a_storage << ", keeping " << shStorage << std::endl;
+    return;
+  }
+  if (a_storage == shStorage)
+    return;
+
+  const uint32_t N     = uint32_t(gridSize);
+  const size_t   cells = size_t(N)*N*N;
+  float sh[SH_COEFFS];
+
+  GridPlane<float>            fp32;
+  GridPlane<uint16_t>         fp16;
+  GridPlane<uint8_t>          q8;
+  GridPlane<float>            scale, offset;
+  uint32_t                    brickRes = 0;
+
+  if (a_storage == SH_STORAGE_FP32)
+  {
+    fp32.resize(cells*SH_COEFFS);
+    for (size_t cell = 0; cell < cells; cell++)
+      DecodeSH(uint32_t(cell), fp32.data() + cell*SH_COEFFS);
+  }
+  else if (a_storage == SH_STORAGE_FP16)
+  {
+    fp16.resize(cells*SH_COEFFS);
+    for (size_t cell = 0; cell < cells; cell++)
+    {
+      DecodeSH(uint32_t(cell), sh);
+      for (size_t i = 0; i < SH_COEFFS; i++)
+      {
+        const half_float::half value = half_float::half_cast<half_float::half, std::round_to_nearest>(sh[i]);
+        std::memcpy(&fp16[cell*SH_COEFFS + i], &value, sizeof(uint16_t)); // the IEEE bits DecodeSH expands
+      }
+    }
+  }
+  else
+  {
+    brickRes = (N + BRICK_SIZE - 1) / BRICK_SIZE;
+    q8.resize(cells*SH_COEFFS);
+    scale.resize(size_t(brickRes)*brickRes*brickRes*SH_COEFFS);
+    offset.resize(scale.size());
+
+    for (uint32_t bz = 0; bz < brickRes; bz++)
+    for (uint32_t by = 0; by < brickRes; by++)
+    for (uint32_t bx = 0; bx < brickRes; bx++)
+    {
+      const uint32_t x0 = bx*BRICK_SIZE, x1 = std::min(x0 + BRICK_SIZE, N);
+      const uint32_t y0 = by*BRICK_SIZE, y1 = std::min(y0 + BRICK_SIZE, N);
+      const uint32_t z0 = bz*BRICK_SIZE, z1 = std::min(z0 + BRICK_SIZE, N);
+
+      float lo[SH_COEFFS], hi[SH_COEFFS];
+      std::fill(lo, lo + SH_COEFFS, +1e30f);
+      std::fill(hi, hi + SH_COEFFS, -1e30f);
+      for (uint32_t z = z0; z < z1; z++)
+        for (uint32_t y = y0; y < y1; y++)
+          for (uint32_t x = x0; x < x1; x++)
+          {
+            DecodeSH(x + y*N + z*N*N, sh);
+            for (size_t i = 0; i < SH_COEFFS; i++)
+            {
+              lo[i] = std::min(lo[i], sh[i]);
+              hi[i] = std::max(hi[i], sh[i]);
+            }
+          }
+
+      // a brick where a coefficient is constant gets scale 0 and reproduces it exactly through the offset
+      const size_t brick = size_t(bx + by*brickRes + bz*brickRes*brickRes)*SH_COEFFS;
+      for (size_t i = 0; i < SH_COEFFS; i++)
+      {
+        scale [brick + i] = (hi[i] - lo[i]) / 255.0f;
+        offset[brick + i] = lo[i];
+      }
+
+      for (uint32_t z = z0; z < z1; z++)
+        for (uint32_t y = y0; y < y1; y++)
+          for (uint32_t x = x0; x < x1; x++)
+          {
+            const size_t cell = x + y*N + size_t(z)*N*N;
+            DecodeSH(uint32_t(cell), sh);
+            for (size_t i = 0; i < SH_COEFFS; i++)
+            {
+              const float q = (scale[brick + i] > 0.0f) ? (sh[i] - lo[i]) / scale[brick + i] : 0.0f;
+              q8[cell*SH_COEFFS + i] = uint8_t(std::min(std::max(std::round(q), 0.0f), 255.0f));
+            }
+          }
+    }
+  }
+
+  gridSH        = std::move(fp32);
+  gridSHHalf    = std::move(fp16);
+  gridSHQ8      = std::move(q8);
+  shBrickScale  = std::move(scale);
+  shBrickOffset = std::move(offset);
+  shBrickRes    = brickRes;
+  shStorage     = a_storage;
+
+  m_lodLevels.clear(); // coarse levels were filtered from the old encoding, rebuilt by the next RayMarch that needs them
+  ResetProgressive();
+}
+
+size_t RayMarcherExample::GetSHBytes() const
+{
+  return gridSH.size()*sizeof(float) + gridSHHalf.size()*sizeof(uint16_t) + gridSHQ8.size()*sizeof(uint8_t) +
+         (shBrickScale.size() + shBrickOffset.size())*sizeof(float);
+}
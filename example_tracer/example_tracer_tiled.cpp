@@ -0,0 +1,91 @@
+#include <chrono>
+#include <atomic>
+
+#include "example_tracer.h"
+#include "work_stealing_pool.h"
+
+void RayMarcherExample::SetRenderThreads(uint32_t a_threads, uint32_t a_tileSize)
+{
+  if (a_threads == 0)
+    a_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  m_tileSize = a_tileSize;
+  if (m_pool == nullptr || m_pool->ThreadCount() != a_threads)
+    m_pool = std::make_shared<WorkStealingPool>(a_threads);
+}
+
+void RayMarcherExample::RayMarchTiled(uint32_t* out_color, uint32_t width, uint32_t height)
+{
+  const uint32_t tilesX = (width  + m_tileSize - 1) / m_tileSize;
+  const uint32_t tilesY = (height + m_tileSize - 1) / m_tileSize;
+
+  // in scalar mode every pixel is computed by the same RayMarchPixel as in kernel2D_RayMarch, so the image matches the
+  // serial one exactly; sample counts are kept per tile and summed in tile order afterwards
+  m_tileSamples.assign(size_t(tilesX)*tilesY, 0);
+
+  m_pool->Run(tilesX*tilesY, [&](uint32_t tile, uint32_t)
+  {
+    const uint32_t x0 = (tile % tilesX)*m_tileSize;
+    const uint32_t y0 = (tile / tilesX)*m_tileSize;
+    const uint32_t x1 = std::min(x0 + m_tileSize, width);
+    const uint32_t y1 = std::min(y0 + m_tileSize, height);
+
+    m_tileSamples[tile] = RayMarchBlock(out_color, width, height, x0, y0, x1, y1, m_worldViewProjInv, m_worldViewInv);
+  });
+
+  for (uint64_t samples : m_tileSamples)
+    m_samplesTaken += samples;
+}
+
+void RayMarcherExample::RayMarchBatch(const float4x4* a_worldView, const float4x4* a_proj, uint32_t* const* a_outColor, uint32_t a_count,
+                                      uint32_t width, uint32_t height, const std::function<void(uint32_t)>& a_onViewDone)
+{
+  m_samplesTaken = 0;
+  m_raysTraced   = uint64_t(width)*uint64_t(height)*a_count;
+  const auto start = std::chrono::high_resolution_clock::now();
+  if (m_lodPolicy != LOD_OFF && m_lodLevels.empty())
+    BuildLodPyramid();
+
+  std::vector<float4x4> viewProjInv(a_count), viewInv(a_count);
+  for (uint32_t view = 0; view < a_count; view++)
+  {
+    viewProjInv[view] = inverse4x4(a_proj[view]);
+    viewInv[view]     = inverse4x4(a_worldView[view]);
+  }
+
+  // without a pool every view is a single block on the calling thread
+  const bool     tiled        = (m_pool != nullptr && m_tileSize != 0);
+  const uint32_t tileSize     = tiled ? m_tileSize : std::max(width, height);
+  const uint32_t tilesX       = (width  + tileSize - 1) / tileSize;
+  const uint32_t tilesY       = (height + tileSize - 1) / tileSize;
+  const uint32_t tilesPerView = tilesX*tilesY;
+
+  m_tileSamples.assign(size_t(tilesPerView)*a_count, 0);
+  std::unique_ptr<std::atomic<uint32_t>[]> tilesLeft(new std::atomic<uint32_t>[a_count]);
+  for (uint32_t view = 0; view < a_count; view++)
+    tilesLeft[view] = tilesPerView;
+
+  auto renderTile = [&](uint32_t task, uint32_t)
+  {
+    const uint32_t view = task / tilesPerView;
+    const uint32_t tile = task % tilesPerView;
+    const uint32_t x0   = (tile % tilesX)*tileSize;
+    const uint32_t y0   = (tile / tilesX)*tileSize;
+    const uint32_t x1   = std::min(x0 + tileSize, width);
+    const uint32_t y1   = std::min(y0 + tileSize, height);
+
+    m_tileSamples[task] = RayMarchBlock(a_outColor[view], width, height, x0, y0, x1, y1, viewProjInv[view], viewInv[view]);
+    if (tilesLeft[view].fetch_sub(1) == 1 && a_onViewDone)
+      a_onViewDone(view);
+  };
+
+  if (tiled)
+    m_pool->Run(tilesPerView*a_count, renderTile);
+  else
+    for (uint32_t task = 0; task < tilesPerView*a_count; task++)
+      renderTile(task, 0);
+
+  for (uint64_t samples : m_tileSamples)
+    m_samplesTaken += samples;
+  rayMarchTime = float(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count())/1000.f;
+}
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "frame_writer.h"
+#include "Image2d.h"
+
+AsyncFrameWriter::AsyncFrameWriter(uint32_t a_width, uint32_t a_height, uint32_t a_buffers) : m_width(a_width), m_height(a_height)
+{
+  m_buffers.resize(std::max(a_buffers, 1u));
+  for (auto& buffer : m_buffers)
+  {
+    buffer.resize(size_t(a_width)*a_height);
+    m_free.push_back(buffer.data());
+  }
+  m_thread = std::thread(&AsyncFrameWriter::WriterLoop, this);
+}
+
+AsyncFrameWriter::~AsyncFrameWriter()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_quit = true;
+  }
+  m_changed.notify_all();
+  m_thread.join();
+}
+
+uint32_t* AsyncFrameWriter::Acquire()
+{
+  const auto start = std::chrono::high_resolution_clock::now();
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_changed.wait(lock, [this] { return !m_free.empty(); });
+  uint32_t* frame = m_free.back();
+  m_free.pop_back();
+  m_stallMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  return frame;
+}
+
+void AsyncFrameWriter::Submit(uint32_t* a_frame, const std::string& a_fileName)
+{
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_queue.push_back({a_frame, a_fileName});
+  }
+  m_changed.notify_all();
+}
+
+void AsyncFrameWriter::Flush()
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_changed.wait(lock, [this] { return m_queue.empty() && !m_writing; });
+}
+
+void AsyncFrameWriter::WriterLoop()
+{
+  while (true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_changed.wait(lock, [this] { return m_quit || !m_queue.empty(); });
+      if (m_queue.empty())
+        return;                        // m_quit and nothing left to write
+      job = std::move(m_queue.front());
+      m_queue.pop_front();
+      m_writing = true;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    if (!LiteImage::SaveBMP(job.fileName.c_str(), job.frame, int(m_width), int(m_height)))
+      std::cout << "[AsyncFrameWriter::WriterLoop]: can't write '" << job.fileName << "'" << std::endl;
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      m_free.push_back(job.frame);
+      m_writing = false;
+      m_written++;
+      m_writeMs += ms;
+    }
+    m_changed.notify_all();
+  }
+}
+
+uint32_t AsyncFrameWriter::FramesWritten() const
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  return m_written;
+}
+
+float AsyncFrameWriter::WriteTimeMs() const
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  return float(m_writeMs);
+}
+
+float AsyncFrameWriter::StallTimeMs() const
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  return float(m_stallMs);
+}
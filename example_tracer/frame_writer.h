@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+/**
+\brief Writes rendered frames to BMP files on a background thread.
+       Frames live in a fixed set of buffers: Acquire hands out a free one, Submit queues it for writing and the writer
+       thread puts it back on the free list once the file is written. A render loop therefore never allocates frames
+       and never runs more than a_buffers frames ahead of the disk, Acquire waits instead.
+*/
+class AsyncFrameWriter
+{
+public:
+
+  AsyncFrameWriter(uint32_t a_width, uint32_t a_height, uint32_t a_buffers);
+  ~AsyncFrameWriter(); ///< writes everything that was submitted, then stops the thread
+
+  AsyncFrameWriter(const AsyncFrameWriter&)            = delete;
+  AsyncFrameWriter& operator=(const AsyncFrameWriter&) = delete;
+
+  uint32_t* Acquire();                                                ///< width*height pixels, waits for a free buffer
+  void      Submit(uint32_t* a_frame, const std::string& a_fileName); ///< thread safe, a_frame must come from Acquire
+  void      Flush();                                                  ///< waits until every submitted frame is on disk
+
+  uint32_t  FramesWritten() const;
+  float     WriteTimeMs()   const; ///< spent in SaveBMP on the writer thread
+  float     StallTimeMs()   const; ///< spent in Acquire waiting for a buffer
+
+private:
+
+  struct Job
+  {
+    uint32_t*   frame;
+    std::string fileName;
+  };
+
+  void WriterLoop();
+
+  uint32_t                            m_width;
+  uint32_t                            m_height;
+  std::vector<std::vector<uint32_t> > m_buffers;
+  std::vector<uint32_t*>              m_free;
+  std::deque<Job>                     m_queue;
+  bool                                m_writing = false;
+  bool                                m_quit    = false;
+
+  uint32_t                            m_written = 0;
+  double                              m_writeMs = 0.0;
+  double                              m_stallMs = 0.0;
+
+  mutable std::mutex                  m_lock;
+  std::condition_variable             m_changed;
+  std::thread                         m_thread;
+};
@@ -0,0 +1,401 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define GRID_FILE_MMAP 1
+#endif
+
+#include "grid_file.h"
+
+namespace
+{
+  struct FileImage
+  {
+    char*                 data = nullptr;
+    size_t                size = 0;
+    bool                  mapped = false;
+    std::shared_ptr<void> keepAlive;
+  };
+
+  bool OpenImage(const char* a_fileName, FileImage* a_image)
+  {
+    #ifdef GRID_FILE_MMAP
+    const int fd = open(a_fileName, O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+      close(fd);
+      return false;
+    }
+    const size_t size = size_t(st.st_size);
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+      return false;
+    a_image->data      = (char*)addr;
+    a_image->size      = size;
+    a_image->mapped    = true;
+    a_image->keepAlive = std::shared_ptr<void>(addr, [size](void* p) { munmap(p, size); });
+    return true;
+    #else
+    std::ifstream fin(a_fileName, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!fin)
+      return false;
+    auto buffer = std::make_shared<std::vector<char> >(size_t(fin.tellg()));
+    fin.seekg(0);
+    fin.read(buffer->data(), buffer->size());
+    a_image->data      = buffer->data();
+    a_image->size      = buffer->size();
+    a_image->mapped    = false;
+    a_image->keepAlive = buffer;
+    return bool(fin);
+    #endif
+  }
+
+  template<typename T> T ByteSwap(T a_val)
+  {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &a_val, sizeof(T));
+    for (size_t i = 0; i < sizeof(T)/2; i++)
+      std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+    std::memcpy(&a_val, bytes, sizeof(T));
+    return a_val;
+  }
+
+  void SwapHeader(GridFileHeader& h)
+  {
+    h.version      = ByteSwap(h.version);
+    h.endianTag    = ByteSwap(h.endianTag);
+    h.gridSize     = ByteSwap(h.gridSize);
+    h.shWidth      = ByteSwap(h.shWidth);
+    h.brickSize    = ByteSwap(h.brickSize);
+    h.sectionCount = ByteSwap(h.sectionCount);
+    for (int i = 0; i < 3; i++)
+    {
+      h.bbMin[i] = ByteSwap(h.bbMin[i]);
+      h.bbMax[i] = ByteSwap(h.bbMax[i]);
+    }
+  }
+
+  void SwapSection(GridFileSection& s)
+  {
+    s.channel        = ByteSwap(s.channel);
+    s.encoding       = ByteSwap(s.encoding);
+    s.componentCount = ByteSwap(s.componentCount);
+    s.fillValue      = ByteSwap(s.fillValue);
+    s.offset         = ByteSwap(s.offset);
+    s.size           = ByteSwap(s.size);
+  }
+
+  uint64_t Align(uint64_t a_offset) { return (a_offset + GRID_FILE_ALIGNMENT - 1) / GRID_FILE_ALIGNMENT * GRID_FILE_ALIGNMENT; }
+
+  struct BrickRange { uint32_t x0, y0, z0, x1, y1, z1; };
+
+  BrickRange GetBrick(uint32_t a_brick, uint32_t a_gridSize, uint32_t a_brickSize)
+  {
+    const uint32_t res = (a_gridSize + a_brickSize - 1) / a_brickSize;
+    BrickRange r;
+    r.x0 = (a_brick % res)*a_brickSize;
+    r.y0 = ((a_brick / res) % res)*a_brickSize;
+    r.z0 = (a_brick / (res*res))*a_brickSize;
+    r.x1 = std::min(r.x0 + a_brickSize, a_gridSize);
+    r.y1 = std::min(r.y0 + a_brickSize, a_gridSize);
+    r.z1 = std::min(r.z0 + a_brickSize, a_gridSize);
+    return r;
+  }
+
+  // appends the sparse brick encoding of a plane to a_out
+  void EncodeSparseBricks(const float* a_plane, uint32_t a_gridSize, uint32_t a_comps, std::vector<char>& a_out)
+  {
+    const uint32_t res    = (a_gridSize + BRICK_SIZE - 1) / BRICK_SIZE;
+    const uint32_t bricks = res*res*res;
+    std::vector<uint64_t> table(bricks, GRID_BRICK_EMPTY);
+    std::vector<float>    payload;
+
+    std::vector<float> brick;
+    for (uint32_t b = 0; b < bricks; b++)
+    {
+      const BrickRange r = GetBrick(b, a_gridSize, BRICK_SIZE);
+      brick.clear();
+      bool empty = true;
+      for (uint32_t z = r.z0; z < r.z1; z++)
+        for (uint32_t y = r.y0; y < r.y1; y++)
+          for (uint32_t x = r.x0; x < r.x1; x++)
+          {
+            const float* cell = a_plane + (size_t(x) + size_t(y)*a_gridSize + size_t(z)*a_gridSize*a_gridSize)*a_comps;
+            for (uint32_t c = 0; c < a_comps; c++)
+            {
+              brick.push_back(cell[c]);
+              empty = empty && (cell[c] == 0.0f);
+            }
+          }
+      if (empty)
+        continue;
+      table[b] = bricks*sizeof(uint64_t) + payload.size()*sizeof(float);
+      payload.insert(payload.end(), brick.begin(), brick.end());
+    }
+
+    const size_t first = a_out.size();
+    a_out.resize(first + table.size()*sizeof(uint64_t) + payload.size()*sizeof(float));
+    std::memcpy(a_out.data() + first, table.data(), table.size()*sizeof(uint64_t));
+    std::memcpy(a_out.data() + first + table.size()*sizeof(uint64_t), payload.data(), payload.size()*sizeof(float));
+  }
+
+  bool DecodeSparseBricks(const char* a_data, uint64_t a_size, uint32_t a_gridSize, uint32_t a_brickSize, uint32_t a_comps,
+                          float a_fill, bool a_swap, GridPlane<float>& a_plane)
+  {
+    const uint32_t res    = (a_gridSize + a_brickSize - 1) / a_brickSize;
+    const uint32_t bricks = res*res*res;
+    if (a_size < uint64_t(bricks)*sizeof(uint64_t))
+      return false;
+
+    a_plane.assign(size_t(a_gridSize)*a_gridSize*a_gridSize*a_comps, a_fill);
+    for (uint32_t b = 0; b < bricks; b++)
+    {
+      uint64_t offset;
+      std::memcpy(&offset, a_data + size_t(b)*sizeof(uint64_t), sizeof(offset));
+      if (a_swap)
+        offset = ByteSwap(offset);
+      if (offset == GRID_BRICK_EMPTY)
+        continue;
+
+      const BrickRange r     = GetBrick(b, a_gridSize, a_brickSize);
+      const uint64_t   bytes = uint64_t(r.x1 - r.x0)*(r.y1 - r.y0)*(r.z1 - r.z0)*a_comps*sizeof(float);
+      if (bytes > a_size || offset > a_size - bytes) // offset + bytes could wrap around
+        return false;
+
+      const char* src = a_data + offset;
+      for (uint32_t z = r.z0; z < r.z1; z++)
+        for (uint32_t y = r.y0; y < r.y1; y++)
+          for (uint32_t x = r.x0; x < r.x1; x++)
+          {
+            float* cell = a_plane.data() + (size_t(x) + size_t(y)*a_gridSize + size_t(z)*a_gridSize*a_gridSize)*a_comps;
+            std::memcpy(cell, src, a_comps*sizeof(float));
+            src += a_comps*sizeof(float);
+            if (a_swap)
+              for (uint32_t c = 0; c < a_comps; c++)
+                cell[c] = ByteSwap(cell[c]);
+          }
+    }
+    return true;
+  }
+}
+
+bool IsGridFile(const char* a_fileName)
+{
+  std::ifstream fin(a_fileName, std::ios::in | std::ios::binary);
+  char magic[4] = {0, 0, 0, 0};
+  fin.read(magic, sizeof(magic));
+  return bool(fin) && std::memcmp(magic, GRID_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+bool SaveGridFile(const char* a_fileName, const RayMarcherExample& a_grid, bool a_sparseBricks)
+{
+  const uint32_t N     = uint32_t(a_grid.gridSize);
+  const size_t   cells = size_t(N)*N*N;
+  if (a_grid.GetSHStorage() != SH_STORAGE_FP32)
+  {
+    std::cout << "[SaveGridFile]: grid files keep fp32 SH, save the grid before SetSHStorage" << std::endl;
+    return false;
+  }
+  if (a_grid.gridDensity.size() != cells || a_grid.gridSH.size() != cells*SH_COEFFS)
+  {
+    std::cout << "[SaveGridFile]: grid planes do not match gridSize = " << N << std::endl;
+    return false;
+  }
+
+  GridFileHeader header = {};
+  std::memcpy(header.magic, GRID_FILE_MAGIC, sizeof(header.magic));
+  header.version      = GRID_FILE_VERSION;
+  header.endianTag    = GRID_FILE_ENDIAN;
+  header.gridSize     = N;
+  header.shWidth      = SH_WIDTH;
+  header.brickSize    = BRICK_SIZE;
+  header.sectionCount = 2;
+  for (int i = 0; i < 3; i++)
+  {
+    header.bbMin[i] = a_grid.bb.min[i];
+    header.bbMax[i] = a_grid.bb.max[i];
+  }
+
+  const float*   planes[2] = {a_grid.gridDensity.data(), a_grid.gridSH.data()};
+  const uint32_t comps[2]  = {1, uint32_t(SH_COEFFS)};
+
+  GridFileSection   sections[2] = {};
+  std::vector<char> payloads[2];
+  uint64_t offset = Align(sizeof(header) + sizeof(sections));
+  for (int i = 0; i < 2; i++)
+  {
+    sections[i].channel        = (i == 0) ? GRID_CHANNEL_DENSITY : GRID_CHANNEL_SH;
+    sections[i].encoding       = a_sparseBricks ? GRID_ENCODING_SPARSE_BRICKS : GRID_ENCODING_RAW;
+    sections[i].componentCount = comps[i];
+    sections[i].fillValue      = 0.0f;
+    sections[i].offset         = offset;
+    if (a_sparseBricks)
+    {
+      EncodeSparseBricks(planes[i], N, comps[i], payloads[i]);
+      sections[i].size = payloads[i].size();
+    }
+    else
+      sections[i].size = cells*comps[i]*sizeof(float);
+    offset = Align(offset + sections[i].size);
+  }
+
+  std::ofstream fout(a_fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!fout)
+  {
+    std::cout << "[SaveGridFile]: can't open file '" << a_fileName << "' " << std::endl;
+    return false;
+  }
+
+  fout.write((const char*)&header, sizeof(header));
+  fout.write((const char*)sections, sizeof(sections));
+  for (int i = 0; i < 2; i++)
+  {
+    const std::vector<char> padding(size_t(sections[i].offset - uint64_t(fout.tellp())), 0);
+    fout.write(padding.data(), padding.size());
+    if (a_sparseBricks)
+      fout.write(payloads[i].data(), payloads[i].size());
+    else
+      fout.write((const char*)planes[i], sections[i].size);
+  }
+  return bool(fout);
+}
+
+bool LoadGridFile(const char* a_fileName, RayMarcherExample& a_grid, GridFileStats* a_stats)
+{
+  FileImage image;
+  if (!OpenImage(a_fileName, &image))
+  {
+    std::cout << "[LoadGridFile]: can't open file '" << a_fileName << "' " << std::endl;
+    return false;
+  }
+
+  GridFileHeader header;
+  if (image.size < sizeof(header))
+  {
+    std::cout << "[LoadGridFile]: file '" << a_fileName << "' is too small" << std::endl;
+    return false;
+  }
+  std::memcpy(&header, image.data, sizeof(header));
+
+  const bool swap = (header.endianTag == ByteSwap(GRID_FILE_ENDIAN));
+  if (swap)
+    SwapHeader(header);
+
+  if (std::memcmp(header.magic, GRID_FILE_MAGIC, sizeof(header.magic)) != 0 || header.endianTag != GRID_FILE_ENDIAN)
+  {
+    std::cout << "[LoadGridFile]: '" << a_fileName << "' is not a grid file" << std::endl;
+    return false;
+  }
+  if (header.version == 0 || header.version > GRID_FILE_VERSION || header.shWidth != SH_WIDTH || header.gridSize < 2 || header.gridSize > GRID_FILE_MAX_SIZE ||
+      header.brickSize == 0 || header.brickSize > GRID_FILE_MAX_SIZE)
+  {
+    std::cout << "[LoadGridFile]: unsupported grid file '" << a_fileName << "', version = " << header.version
+              << ", shWidth = " << header.shWidth << ", gridSize = " << header.gridSize << std::endl;
+    return false;
+  }
+  if (image.size < sizeof(header) + header.sectionCount*sizeof(GridFileSection))
+  {
+    std::cout << "[LoadGridFile]: truncated section table in '" << a_fileName << "'" << std::endl;
+    return false;
+  }
+
+  const uint32_t N     = header.gridSize;
+  const size_t   cells = size_t(N)*N*N;
+  GridFileStats  stats;
+  stats.mapped = image.mapped;
+
+  // sections are decoded aside, a_grid is left untouched unless the whole file is valid
+  GridPlane<float> planes[2];
+  bool loaded[2] = {false, false};
+  for (uint32_t i = 0; i < header.sectionCount; i++)
+  {
+    GridFileSection section;
+    std::memcpy(&section, image.data + sizeof(header) + i*sizeof(section), sizeof(section));
+    if (swap)
+      SwapSection(section);
+
+    if (section.channel > GRID_CHANNEL_SH)
+      continue;                                                  // channels of newer writers are skipped
+
+    GridPlane<float>& plane = planes[section.channel];
+    const uint32_t    comps = (section.channel == GRID_CHANNEL_DENSITY) ? 1 : uint32_t(SH_COEFFS);
+    if (section.componentCount != comps || section.size > image.size || section.offset > image.size - section.size ||
+        section.offset % sizeof(float) != 0)
+    {
+      std::cout << "[LoadGridFile]: bad section " << i << " in '" << a_fileName << "'" << std::endl;
+      return false;
+    }
+
+    char* payload = image.data + section.offset;
+    if (section.encoding == GRID_ENCODING_RAW)
+    {
+      if (section.size != cells*comps*sizeof(float))
+      {
+        std::cout << "[LoadGridFile]: bad size of section " << i << " in '" << a_fileName << "'" << std::endl;
+        return false;
+      }
+      if (swap)
+      {
+        plane.resize(cells*comps);
+        std::memcpy(plane.data(), payload, section.size);
+        for (auto& val : plane)
+          val = ByteSwap(val);
+        stats.bytesDecoded += section.size;
+      }
+      else
+      {
+        plane.bind((float*)payload, cells*comps, image.keepAlive);
+        stats.bytesInPlace += section.size;
+      }
+    }
+    else if (section.encoding == GRID_ENCODING_SPARSE_BRICKS)
+    {
+      if (!DecodeSparseBricks(payload, section.size, N, header.brickSize, comps, section.fillValue, swap, plane))
+      {
+        std::cout << "[LoadGridFile]: corrupted brick table in section " << i << " of '" << a_fileName << "'" << std::endl;
+        return false;
+      }
+      stats.bytesDecoded += cells*comps*sizeof(float);
+    }
+    else
+    {
+      std::cout << "[LoadGridFile]: unknown encoding " << section.encoding << " in '" << a_fileName << "'" << std::endl;
+      return false;
+    }
+    loaded[section.channel] = true;
+  }
+
+  if (!loaded[GRID_CHANNEL_DENSITY] || !loaded[GRID_CHANNEL_SH])
+  {
+    std::cout << "[LoadGridFile]: density or SH section is missing in '" << a_fileName << "'" << std::endl;
+    return false;
+  }
+
+  a_grid.gridDensity = std::move(planes[GRID_CHANNEL_DENSITY]);
+  a_grid.gridSH      = std::move(planes[GRID_CHANNEL_SH]);
+
+  // the file holds fp32 SH; drop a previous fp16/q8 encoding so DecodeSH reads the new gridSH
+  a_grid.gridSHHalf    = {};
+  a_grid.gridSHQ8      = {};
+  a_grid.shBrickScale  = {};
+  a_grid.shBrickOffset = {};
+  a_grid.shBrickRes    = 0;
+  a_grid.shStorage     = SH_STORAGE_FP32;
+
+  a_grid.gridSize = N;
+  a_grid.SetBoundingBox(float3(header.bbMin[0], header.bbMin[1], header.bbMin[2]), float3(header.bbMax[0], header.bbMax[1], header.bbMax[2]));
+  a_grid.RebuildOccupancy();
+
+  if (a_stats != nullptr)
+    (*a_stats) = stats;
+  return true;
+}
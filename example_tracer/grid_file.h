@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+#include "example_tracer.h"
+
+/**
+  Self-describing grid file ('.plnx'), all values little endian unless endianTag says otherwise:
+
+    GridFileHeader
+    GridFileSection[header.sectionCount]
+    section payloads, each starting at a GRID_FILE_ALIGNMENT boundary
+
+  A GRID_ENCODING_RAW section holds gridSize^3 cells of componentCount floats in the renderer's plane order
+  (x + y*gridSize + z*gridSize^2), so it is used in place from the mapping. A GRID_ENCODING_SPARSE_BRICKS section
+  stores a table of brickCount uint64 payload offsets (relative to the section, GRID_BRICK_EMPTY for bricks
+  where every value equals fillValue) followed by the non-empty bricks, cells of a brick in x, y, z order;
+  such sections are decoded into owned memory on load.
+*/
+
+const char     GRID_FILE_MAGIC[4]  = {'P', 'L', 'N', 'X'};
+const uint32_t GRID_FILE_VERSION   = 1;
+const uint32_t GRID_FILE_ENDIAN    = 0x01020304;
+const uint64_t GRID_FILE_ALIGNMENT = 64;
+const uint64_t GRID_BRICK_EMPTY    = ~uint64_t(0);
+const uint32_t GRID_FILE_MAX_SIZE  = 1024;        // larger gridSize or brickSize is rejected, cells are indexed in int32 (N^3 < 2^31)
+
+enum GRID_CHANNEL  { GRID_CHANNEL_DENSITY = 0, GRID_CHANNEL_SH = 1 };
+enum GRID_ENCODING { GRID_ENCODING_RAW = 0, GRID_ENCODING_SPARSE_BRICKS = 1 };
+
+struct GridFileHeader
+{
+  char     magic[4];
+  uint32_t version;
+  uint32_t endianTag;
+  uint32_t gridSize;
+  float    bbMin[3];
+  float    bbMax[3];
+  uint32_t shWidth;
+  uint32_t brickSize;
+  uint32_t sectionCount;
+  uint32_t reserved[3];
+};
+
+struct GridFileSection
+{
+  uint32_t channel;        ///< GRID_CHANNEL
+  uint32_t encoding;       ///< GRID_ENCODING
+  uint32_t componentCount; ///< floats per cell
+  float    fillValue;      ///< value of the cells in omitted bricks
+  uint64_t offset;         ///< from the beginning of the file
+  uint64_t size;           ///< in bytes
+};
+
+static_assert(sizeof(GridFileHeader)  == 64, "GridFileHeader layout is part of the file format");
+static_assert(sizeof(GridFileSection) == 32, "GridFileSection layout is part of the file format");
+
+struct GridFileStats
+{
+  bool   mapped        = false; ///< file was memory mapped
+  size_t bytesInPlace  = 0;     ///< section bytes used directly from the mapping
+  size_t bytesDecoded  = 0;     ///< section bytes decoded or copied into owned memory
+};
+
+/**
+\brief write density and SH planes of a_grid; a_sparseBricks omits bricks of BRICK_SIZE^3 cells that are all zero
+*/
+bool SaveGridFile(const char* a_fileName, const RayMarcherExample& a_grid, bool a_sparseBricks);
+
+/**
+\brief map the file and bind a_grid's planes to it (sets gridSize, bb and rebuilds occupancy).
+       Mapped pages are private: editing the grid afterwards copies only the touched pages and never changes the file.
+*/
+bool LoadGridFile(const char* a_fileName, RayMarcherExample& a_grid, GridFileStats* a_stats = nullptr);
+
+/**
+\brief true if the file starts with GRID_FILE_MAGIC
+*/
+bool IsGridFile(const char* a_fileName);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+#ifdef KERNEL_SLICER
+
+template<typename T> using GridPlane = std::vector<T>;
+
+#else
+
+/**
+\brief One channel of the grid (density, SH, ...). Either owns its cells like std::vector or views memory that
+       belongs to someone else, e.g. a section of a memory mapped grid file; a_keepAlive holds that memory.
+       Moving keeps a view, copying a view copies its cells.
+*/
+template<typename T>
+class GridPlane
+{
+public:
+
+  GridPlane() = default;
+  GridPlane(GridPlane&& rhs) = default;
+  GridPlane(const GridPlane& rhs) { *this = rhs; }
+
+  GridPlane& operator=(GridPlane&& rhs) = default;
+  GridPlane& operator=(const GridPlane& rhs)
+  {
+    if (this == &rhs)
+      return *this;
+    m_own.assign(rhs.begin(), rhs.end()); // a copy always owns its cells; sharing MAP_PRIVATE pages would alias writes
+    Own();
+    return *this;
+  }
+
+  void resize(size_t a_size)                 { m_own.resize(a_size); Own(); }
+  void assign(size_t a_size, const T& a_val) { m_own.assign(a_size, a_val); Own(); }
+  void clear()                               { m_own.clear(); Own(); }
+  void shrink_to_fit()                       { m_own.shrink_to_fit(); Own(); }
+
+  void bind(T* a_data, size_t a_size, std::shared_ptr<void> a_keepAlive)
+  {
+    m_own.clear();
+    m_own.shrink_to_fit();
+    m_data      = a_data;
+    m_size      = a_size;
+    m_keepAlive = std::move(a_keepAlive);
+  }
+
+  bool isView() const { return m_keepAlive != nullptr; }
+
+  T&       operator[](size_t i)       { return m_data[i]; }
+  const T& operator[](size_t i) const { return m_data[i]; }
+
+  T*       data()        { return m_data; }
+  const T* data()  const { return m_data; }
+  size_t   size()  const { return m_size; }
+  bool     empty() const { return m_size == 0; }
+
+  T*       begin()       { return m_data; }
+  T*       end()         { return m_data + m_size; }
+  const T* begin() const { return m_data; }
+  const T* end()   const { return m_data + m_size; }
+
+private:
+
+  void Own() { m_data = m_own.data(); m_size = m_own.size(); m_keepAlive = nullptr; }
+
+  std::vector<T>        m_own;
+  T*                    m_data = nullptr;
+  size_t                m_size = 0;
+  std::shared_ptr<void> m_keepAlive;
+};
+
+#endif
@@ -0,0 +1,510 @@
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+
+#include "grid_trainer.h"
+#include "Image2d.h"
+
+// defined in example_tracer.cpp
+void   sh_eval_2(const float3 &d, float *out);
+float2 RayBoxIntersection(float3 ray_pos, float3 ray_dir, float3 boxMin, float3 boxMax);
+
+bool LoadTrainViews(const char* a_posesFile, std::vector<TrainView>* a_views)
+{
+  std::ifstream fin(a_posesFile);
+  if (!fin)
+  {
+    std::cout << "[LoadTrainViews]: can't open file '" << a_posesFile << "' " << std::endl;
+    return false;
+  }
+
+  const std::string posesPath = a_posesFile;
+  const size_t      slash     = posesPath.find_last_of("/\\");
+  const std::string folder    = (slash == std::string::npos) ? std::string() : posesPath.substr(0, slash + 1);
+
+  std::string line;
+  while (std::getline(fin, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream in(line);
+    std::string imageName;
+    float fovY = 0.0f, m[16];
+    in >> imageName >> fovY;
+    for (int i = 0; i < 16; i++)
+      in >> m[i];
+    if (!in)
+    {
+      std::cout << "[LoadTrainViews]: bad line '" << line << "' in '" << a_posesFile << "'" << std::endl;
+      return false;
+    }
+
+    const std::string imagePath = (imageName[0] == '/') ? imageName : folder + imageName;
+    const auto image = LiteImage::LoadImage<float4>(imagePath.c_str(), 1.0f);
+    if (image.width() == 0 || image.height() == 0)
+      return false;
+
+    // LoadImage returns the top row first, RayMarch writes the bottom row first
+    TrainView view;
+    view.width     = image.width();
+    view.height    = image.height();
+    view.worldView = float4x4(m);
+    view.proj      = perspectiveMatrix(fovY, float(view.width)/float(view.height), 0.1f, 100.0f);
+    view.viewInv   = inverse4x4(view.worldView);
+    view.projInv   = inverse4x4(view.proj);
+    view.pixels.resize(size_t(view.width)*view.height);
+    for (uint32_t y = 0; y < view.height; y++)
+      for (uint32_t x = 0; x < view.width; x++)
+        view.pixels[y*view.width + x] = to_float3(image.data()[(view.height - 1 - y)*view.width + x]);
+    a_views->push_back(std::move(view));
+  }
+  return true;
+}
+
+GridTrainer::GridTrainer(RayMarcherExample& a_grid) : m_grid(a_grid)
+{
+  if (m_grid.m_pool == nullptr)
+    m_grid.SetRenderThreads(0);
+  m_pool = m_grid.m_pool;
+  m_workers.resize(m_pool->ThreadCount());
+  ResetState();
+}
+
+void GridTrainer::ResetState()
+{
+  m_cells = m_grid.gridSize*m_grid.gridSize*m_grid.gridSize;
+  m_gradient.assign(m_cells*PARAMS, 0.0f);
+  m_touchedBits.assign((m_cells + 31)/32, 0u);
+  m_moment1.assign(m_cells*PARAMS, 0.0f);
+  m_moment2.assign(m_cells*PARAMS, 0.0f);
+  m_rangeCells.assign(4*m_workers.size(), std::vector<uint32_t>());
+  m_adamStep     = 0;
+  m_samplesTaken = 0; // samples per ray are reported per stage
+  m_raysTraced   = 0;
+}
+
+size_t GridTrainer::GetStateBytes() const
+{
+  size_t bytes = m_cells*PARAMS*(sizeof(float)*3) + m_touchedBits.size()*sizeof(uint32_t);
+  for (const auto& cells : m_rangeCells)
+    bytes += cells.capacity()*sizeof(uint32_t);
+  for (const auto& worker : m_workers)
+    bytes += worker.samples.capacity()*sizeof(Sample) + (worker.table.capacity() + worker.slotCell.capacity())*sizeof(uint32_t) +
+             (worker.rangeFirst.capacity() + worker.rangeSlots.capacity())*sizeof(uint32_t) + worker.slotGradient.capacity()*sizeof(float);
+  return bytes;
+}
+
+float* GridTrainer::Worker::Slot(uint32_t a_cell)
+{
+  auto hash = [](uint32_t a_key) { const uint32_t h = a_key*2654435761u; return h ^ (h >> 15); };
+
+  if (2*(slotCell.size() + 1) > table.size())                    // keep the table at most half full
+  {
+    table.assign(std::max<size_t>(4096, 2*table.size()), 0u);
+    const uint32_t mask = uint32_t(table.size() - 1);
+    for (uint32_t slot = 0; slot < uint32_t(slotCell.size()); slot++)
+    {
+      uint32_t h = hash(slotCell[slot]) & mask;
+      while (table[h] != 0)
+        h = (h + 1) & mask;
+      table[h] = slot + 1;
+    }
+  }
+
+  const uint32_t mask = uint32_t(table.size() - 1);
+  for (uint32_t h = hash(a_cell) & mask; ; h = (h + 1) & mask)
+  {
+    if (table[h] == 0)
+    {
+      table[h] = uint32_t(slotCell.size()) + 1;
+      slotCell.push_back(a_cell);
+      slotGradient.resize(slotGradient.size() + PARAMS, 0.0f);
+      return slotGradient.data() + slotGradient.size() - PARAMS;
+    }
+    if (slotCell[table[h] - 1] == a_cell)
+      return slotGradient.data() + size_t(table[h] - 1)*PARAMS;
+  }
+}
+
+float GridTrainer::TrainRay(const TrainView& a_view, uint32_t a_x, uint32_t a_y, float a_scale, Worker& a_worker)
+{
+  // same ray as RayMarchPixel
+  float4 pos = a_view.projInv*float4(2.0f*(float(a_x) + 0.5f)/float(a_view.width) - 1.0f, 2.0f*(float(a_y) + 0.5f)/float(a_view.height) - 1.0f, 0.0f, 1.0f);
+  pos /= pos.w;
+  const float3 rayPos = to_float3(a_view.viewInv*float4(0.0f, 0.0f, 0.0f, 1.0f));
+  const float3 rayDir = to_float3(normalize(a_view.viewInv*to_float4(normalize(to_float3(pos)), 0.0f)));
+  const float3 target = a_view.pixels[a_y*a_view.width + a_x];
+
+  const RayMarcherExample& g = m_grid;
+  const float2 tNearAndFar   = RayBoxIntersection(rayPos, rayDir, g.bb.min, g.bb.max);
+  if (!(tNearAndFar.x < tNearAndFar.y && tNearAndFar.y > 0.0f))
+    return dot(target, target);
+
+  // forward, the loop of RayMarchGrid that also records what the backward pass needs
+  float shBasis[SH_WIDTH];
+  sh_eval_2(rayDir, shBasis);
+
+  const float  tmin        = std::max(tNearAndFar.x, 0.0f);
+  const float  tmax        = tNearAndFar.y;
+  const float3 boxSize     = g.bb.max - g.bb.min;
+  const float3 worldToGrid = float3(float(g.gridSize)) / boxSize;
+  const float3 gridOrigin  = (rayPos - g.bb.min)*worldToGrid - float3(0.5f);
+  const float3 gridDir     = rayDir*worldToGrid;
+  const float  dt          = STEP_SIZE_IN_CELLS * std::min(boxSize.x, std::min(boxSize.y, boxSize.z)) / float(g.gridSize);
+
+  std::vector<Sample>& samples = a_worker.samples;
+  samples.clear();
+  float  transmittance = 1.0f;
+  float3 color(0.0f);
+  for (uint32_t i = 0; transmittance > MIN_TRANSMITTANCE; )
+  {
+    const float t = tmin + (float(i) + 0.5f)*dt;
+    if (t >= tmax)
+      break;
+
+    const float3 gridPos = gridOrigin + t*gridDir;
+    if (m_grid.m_skipEmptySpace && m_grid.SkipEmptySpace(gridPos, gridOrigin, gridDir, tmin, tmax, dt, &i))
+      continue;
+
+    Sample s;
+    const float density = m_grid.SampleDensity(gridPos, s.cells, s.weights);
+    s.alpha = 1.0f - std::exp(-std::max(density, 0.0f)*dt);
+    a_worker.samplesTaken++;
+    i++;
+    if (s.alpha < MIN_SAMPLE_ALPHA)
+      continue;
+
+    s.color         = m_grid.SampleColor(s.cells, s.weights, shBasis);
+    s.colorMask     = (s.color.x > 0.0f ? 1u : 0u) | (s.color.y > 0.0f ? 2u : 0u) | (s.color.z > 0.0f ? 4u : 0u);
+    s.transmittance = transmittance;
+    color          += (transmittance*s.alpha)*s.color;
+    transmittance  *= (1.0f - s.alpha);
+    samples.push_back(s);
+  }
+
+  // loss on the clamped color RayMarch outputs, channels saturated at 1 get no gradient
+  const float3 clamped = min(color, float3(1.0f));
+  const float3 diff    = clamped - target;
+  float3 dColor        = 2.0f*a_scale*diff;
+  dColor.x = (color.x < 1.0f) ? dColor.x : 0.0f;
+  dColor.y = (color.y < 1.0f) ? dColor.y : 0.0f;
+  dColor.z = (color.z < 1.0f) ? dColor.z : 0.0f;
+
+  // backward: dC/dsigma_i = dt*(T_i*(1 - alpha_i)*c_i - sum_{j>i} T_j*alpha_j*c_j)
+  float3 behind = color;
+  for (const Sample& s : samples)
+  {
+    const float weight = s.transmittance*s.alpha;
+    behind -= weight*s.color;
+
+    const float3 dSigma   = dt*(s.transmittance*(1.0f - s.alpha)*s.color - behind);
+    const float  dDensity = dot(dColor, dSigma);                 // recorded samples have density > 0, relu passes it
+    const float  dColorR  = (s.colorMask & 1u) ? weight*dColor.x : 0.0f;
+    const float  dColorG  = (s.colorMask & 2u) ? weight*dColor.y : 0.0f;
+    const float  dColorB  = (s.colorMask & 4u) ? weight*dColor.z : 0.0f;
+
+    for (int c = 0; c < 8; c++)
+    {
+      const float w = s.weights[c];
+      if (w == 0.0f)
+        continue;
+      float* grad = a_worker.Slot(s.cells[c]);
+      grad[0] += w*dDensity;
+      for (uint32_t k = 0; k < SH_WIDTH; k++)
+      {
+        const float wb = w*shBasis[k];
+        grad[1 + 0*SH_WIDTH + k] += wb*dColorR;
+        grad[1 + 1*SH_WIDTH + k] += wb*dColorG;
+        grad[1 + 2*SH_WIDTH + k] += wb*dColorB;
+      }
+    }
+  }
+  return dot(diff, diff);
+}
+
+// TV = sum over cells of sqrt(dx^2 + dy^2 + dz^2) per parameter, forward differences. A cell appears in its own term
+// and in the terms of its -x, -y and -z neighbours; all four are gathered here, so only a_cell's gradient is written
+void GridTrainer::AddTotalVariation(uint32_t a_cell)
+{
+  const uint32_t N  = uint32_t(m_grid.gridSize);
+  const uint32_t x  = a_cell % N, y = (a_cell / N) % N, z = a_cell / (N*N);
+  const uint32_t dy = N, dz = N*N;
+
+  const bool hasTerm[4] = {x + 1 < N && y + 1 < N && z + 1 < N,   // own term
+                           x > 0     && y + 1 < N && z + 1 < N,   // term of a_cell - 1
+                           x + 1 < N && y > 0     && z + 1 < N,   // term of a_cell - dy
+                           x + 1 < N && y + 1 < N && z > 0};      // term of a_cell - dz
+  const uint32_t base[4] = {a_cell, a_cell - 1, a_cell - dy, a_cell - dz};
+
+  float* grad = m_gradient.data() + size_t(a_cell)*PARAMS;
+  for (uint32_t p = 0; p < PARAMS; p++)
+  {
+    const float lambda = (p == 0) ? settings.tvDensity : settings.tvSH;
+    if (lambda == 0.0f)
+      continue;
+
+    auto value = [&](uint32_t cell) { return p == 0 ? m_grid.gridDensity[cell] : m_grid.gridSH[size_t(cell)*SH_COEFFS + p - 1]; };
+    for (int t = 0; t < 4; t++)
+    {
+      if (!hasTerm[t])
+        continue;
+      const float v  = value(base[t]);
+      const float gx = value(base[t] + 1) - v, gy = value(base[t] + dy) - v, gz = value(base[t] + dz) - v;
+      const float r  = lambda / std::sqrt(gx*gx + gy*gy + gz*gz + 1e-9f);
+      const float d  = (t == 0) ? -(gx + gy + gz) : (t == 1) ? gx : (t == 2) ? gy : gz;
+      grad[p] += r*d;
+    }
+  }
+}
+
+float GridTrainer::Step(const std::vector<TrainView>& a_views)
+{
+  if (m_grid.GetSHStorage() != SH_STORAGE_FP32 || a_views.empty() || m_grid.gridSize < 2)
+  {
+    std::cout << "[GridTrainer::Step]: needs training views and a grid with fp32 SH" << std::endl;
+    return 0.0f;
+  }
+  if (m_cells != m_grid.gridSize*m_grid.gridSize*m_grid.gridSize)
+    ResetState();
+
+  for (auto& worker : m_workers)
+  {
+    std::fill(worker.table.begin(), worker.table.end(), 0u);
+    worker.slotCell.clear();
+    worker.slotGradient.clear();
+    worker.loss         = 0.0;
+    worker.samplesTaken = 0;
+  }
+
+  // rays are drawn per task from a seed of the iteration and the task, so a batch does not depend on the thread count
+  const uint32_t chunk = 256;
+  const uint32_t rays  = settings.batchRays;
+  const float    scale = 1.0f/float(3*rays);
+  m_pool->Run((rays + chunk - 1)/chunk, [&](uint32_t task, uint32_t thread)
+  {
+    std::minstd_rand rng(m_iteration*65537u + task + 1);
+    Worker& worker = m_workers[thread];
+    for (uint32_t r = task*chunk; r < std::min(rays, (task + 1)*chunk); r++)
+    {
+      const TrainView& view = a_views[rng() % a_views.size()];
+      const uint32_t   x    = rng() % view.width;
+      const uint32_t   y    = rng() % view.height;
+      worker.loss += TrainRay(view, x, y, scale, worker);
+    }
+  });
+
+  // merge, TV and Adam run over cell ranges (multiples of 32 cells, so touched bit words are not shared either)
+  const uint32_t ranges    = uint32_t(m_rangeCells.size());
+  const size_t   rangeSize = ((m_cells + ranges - 1)/ranges + 31)/32*32;
+  m_adamStep++;
+  const float correction1 = 1.0f - std::pow(settings.beta1, float(m_adamStep));
+  const float correction2 = 1.0f - std::pow(settings.beta2, float(m_adamStep));
+  const float decay       = (settings.lrHalfLife == 0) ? 1.0f : std::exp2(-float(m_adamStep - 1)/float(settings.lrHalfLife));
+  const float lrDensity   = settings.lrDensity*decay;
+  const float lrSH        = settings.lrSH*decay;
+
+  // counting sort of every worker's slots by range, so a range task visits only its own slots
+  m_pool->Run(uint32_t(m_workers.size()), [&](uint32_t w, uint32_t)
+  {
+    Worker& worker = m_workers[w];
+    worker.rangeFirst.assign(ranges + 1, 0u);
+    for (uint32_t cell : worker.slotCell)
+      worker.rangeFirst[cell/rangeSize + 1]++;
+    for (uint32_t range = 0; range < ranges; range++)
+      worker.rangeFirst[range + 1] += worker.rangeFirst[range];
+    worker.rangeSlots.resize(worker.slotCell.size());
+    std::vector<uint32_t> next(worker.rangeFirst.begin(), worker.rangeFirst.end() - 1);
+    for (uint32_t slot = 0; slot < uint32_t(worker.slotCell.size()); slot++)
+      worker.rangeSlots[next[worker.slotCell[slot]/rangeSize]++] = slot;
+  });
+
+  m_pool->Run(ranges, [&](uint32_t range, uint32_t)
+  {
+    std::vector<uint32_t>& cells = m_rangeCells[range];
+    cells.clear();
+    for (const Worker& worker : m_workers)
+    {
+      for (uint32_t i = worker.rangeFirst[range]; i < worker.rangeFirst[range + 1]; i++)
+      {
+        const uint32_t slot = worker.rangeSlots[i];
+        const uint32_t cell = worker.slotCell[slot];
+        if (((m_touchedBits[cell >> 5] >> (cell & 31)) & 1u) == 0)
+        {
+          m_touchedBits[cell >> 5] |= 1u << (cell & 31);
+          cells.push_back(cell);
+        }
+        const float* src = worker.slotGradient.data() + size_t(slot)*PARAMS;
+        float*       dst = m_gradient.data() + size_t(cell)*PARAMS;
+        for (uint32_t p = 0; p < PARAMS; p++)
+          dst[p] += src[p];
+      }
+    }
+
+    // TV reads neighbours' parameters, so all of them must be computed before any cell of the range moves
+    if (settings.tvDensity != 0.0f || settings.tvSH != 0.0f)
+      for (uint32_t cell : cells)
+        AddTotalVariation(cell);
+  });
+
+  // sparse Adam over the touched cells, the moments of the other cells are not decayed
+  m_pool->Run(ranges, [&](uint32_t range, uint32_t)
+  {
+    for (uint32_t cell : m_rangeCells[range])
+    {
+      for (uint32_t p = 0; p < PARAMS; p++)
+      {
+        const size_t i  = size_t(cell)*PARAMS + p;
+        const float  gr = m_gradient[i];
+        m_gradient[i]   = 0.0f;
+
+        m_moment1[i] = settings.beta1*m_moment1[i] + (1.0f - settings.beta1)*gr;
+        m_moment2[i] = settings.beta2*m_moment2[i] + (1.0f - settings.beta2)*gr*gr;
+        const float update = (m_moment1[i]/correction1) / (std::sqrt(m_moment2[i]/correction2) + settings.epsilon);
+        if (p == 0)
+          m_grid.gridDensity[cell] -= lrDensity*update;
+        else
+          m_grid.gridSH[size_t(cell)*SH_COEFFS + p - 1] -= lrSH*update;
+      }
+      m_touchedBits[cell >> 5] &= ~(1u << (cell & 31));
+    }
+  });
+
+  double   loss    = 0.0;
+  uint64_t samples = 0;
+  for (const auto& worker : m_workers)
+  {
+    loss    += worker.loss;
+    samples += worker.samplesTaken;
+  }
+  m_lastTouched = 0;
+  for (const auto& cells : m_rangeCells)
+    m_lastTouched += cells.size();
+  m_samplesTaken += samples;
+  m_raysTraced   += rays;
+
+  m_iteration++;
+  if (settings.occupancyInterval != 0 && m_iteration % settings.occupancyInterval == 0)
+    m_grid.RebuildOccupancy();
+
+  return float(loss/double(3*rays));
+}
+
+double GridTrainer::ViewLoss(const TrainView& a_view, std::vector<float>* a_gradient)
+{
+  if (m_grid.GetSHStorage() != SH_STORAGE_FP32 || m_grid.gridSize < 2)
+  {
+    std::cout << "[GridTrainer::ViewLoss]: needs a grid with fp32 SH" << std::endl;
+    return 0.0;
+  }
+  if (m_cells != m_grid.gridSize*m_grid.gridSize*m_grid.gridSize)
+    ResetState();
+
+  Worker& worker = m_workers[0];
+  std::fill(worker.table.begin(), worker.table.end(), 0u);
+  worker.slotCell.clear();
+  worker.slotGradient.clear();
+
+  const float scale = 1.0f/float(3*a_view.width*a_view.height);
+  double loss = 0.0;
+  for (uint32_t y = 0; y < a_view.height; y++)
+    for (uint32_t x = 0; x < a_view.width; x++)
+      loss += double(scale)*TrainRay(a_view, x, y, scale, worker);
+
+  // TV of every cell, its value is the own term AddTotalVariation differentiates
+  const uint32_t N = uint32_t(m_grid.gridSize);
+  for (uint32_t cell = 0; cell < uint32_t(m_cells); cell++)
+  {
+    const uint32_t x = cell % N, y = (cell / N) % N, z = cell / (N*N);
+    if (x + 1 < N && y + 1 < N && z + 1 < N)
+      for (uint32_t p = 0; p < PARAMS; p++)
+      {
+        auto value = [&](uint32_t c) { return p == 0 ? m_grid.gridDensity[c] : m_grid.gridSH[size_t(c)*SH_COEFFS + p - 1]; };
+        const float v  = value(cell);
+        const float gx = value(cell + 1) - v, gy = value(cell + N) - v, gz = value(cell + N*N) - v;
+        loss += double((p == 0) ? settings.tvDensity : settings.tvSH)*std::sqrt(gx*gx + gy*gy + gz*gz + 1e-9f);
+      }
+    if (settings.tvDensity != 0.0f || settings.tvSH != 0.0f)
+      AddTotalVariation(cell);
+  }
+
+  a_gradient->assign(m_gradient.begin(), m_gradient.end());
+  std::fill(m_gradient.begin(), m_gradient.end(), 0.0f);
+  for (size_t slot = 0; slot < worker.slotCell.size(); slot++)
+    for (uint32_t p = 0; p < PARAMS; p++)
+      (*a_gradient)[size_t(worker.slotCell[slot])*PARAMS + p] += worker.slotGradient[slot*PARAMS + p];
+  return loss;
+}
+
+bool GridTrainer::Upsample(uint32_t a_gridSize, float a_pruneDensity)
+{
+  if (m_grid.GetSHStorage() != SH_STORAGE_FP32 || m_grid.gridSize < 2 || a_gridSize < 2)
+  {
+    std::cout << "[GridTrainer::Upsample]: needs a grid with fp32 SH and at least 2 cells per side" << std::endl;
+    return false;
+  }
+
+  const uint32_t N     = a_gridSize;
+  const size_t   cells = size_t(N)*N*N;
+  const float    ratio = float(m_grid.gridSize)/float(N);
+
+  // cell centers of the new grid sampled trilinearly from the old one, as the renderer would
+  GridPlane<float> density, sh;
+  density.resize(cells);
+  sh.resize(cells*SH_COEFFS);
+  m_pool->Run(N, [&](uint32_t z, uint32_t)
+  {
+    for (uint32_t y = 0; y < N; y++)
+      for (uint32_t x = 0; x < N; x++)
+      {
+        const size_t cell = x + y*N + size_t(z)*N*N;
+        uint32_t corners[8];
+        float    weights[8];
+        density[cell] = m_grid.SampleDensity((float3(float(x), float(y), float(z)) + 0.5f)*ratio - 0.5f, corners, weights);
+        for (size_t k = 0; k < SH_COEFFS; k++)
+        {
+          float val = 0.0f;
+          for (int c = 0; c < 8; c++)
+            val += weights[c]*m_grid.gridSH[size_t(corners[c])*SH_COEFFS + k];
+          sh[cell*SH_COEFFS + k] = val;
+        }
+      }
+  });
+
+  // keep cells within one cell of anything dense enough so surfaces don't lose their trilinear support
+  std::vector<uint8_t> keep(cells, 0);
+  m_pool->Run(N, [&](uint32_t z, uint32_t)
+  {
+    for (uint32_t y = 0; y < N; y++)
+      for (uint32_t x = 0; x < N; x++)
+      {
+        bool dense = false;
+        for (uint32_t nz = (z == 0 ? 0 : z - 1); nz <= std::min(z + 1, N - 1) && !dense; nz++)
+          for (uint32_t ny = (y == 0 ? 0 : y - 1); ny <= std::min(y + 1, N - 1) && !dense; ny++)
+            for (uint32_t nx = (x == 0 ? 0 : x - 1); nx <= std::min(x + 1, N - 1) && !dense; nx++)
+              dense = density[nx + ny*N + size_t(nz)*N*N] >= a_pruneDensity;
+        keep[x + y*N + size_t(z)*N*N] = dense ? 1 : 0;
+      }
+  });
+
+  size_t pruned = 0;
+  for (size_t cell = 0; cell < cells; cell++)
+  {
+    if (keep[cell])
+      continue;
+    density[cell] = 0.0f;
+    std::fill(sh.data() + cell*SH_COEFFS, sh.data() + (cell + 1)*SH_COEFFS, 0.0f);
+    pruned++;
+  }
+
+  m_grid.gridDensity = std::move(density);
+  m_grid.gridSH      = std::move(sh);
+  m_grid.gridSize    = N;
+  m_grid.RebuildOccupancy();
+  ResetState();
+
+  std::cout << "[GridTrainer::Upsample]: " << N << "^3 cells, " << pruned << " pruned (" << 100.0*double(pruned)/double(cells) << "%)" << std::endl;
+  return true;
+}
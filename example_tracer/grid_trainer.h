@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "example_tracer.h"
+#include "work_stealing_pool.h"
+
+/**
+  Poses file of LoadTrainViews, one view per line, '#' starts a comment:
+
+    <image> <fovY in degrees> <16 floats of the world-view matrix, row major>
+
+  The image path is relative to the poses file. The matrix is the one passed to SetWorldViewMatrix and the projection
+  is perspectiveMatrix(fovY, width/height, 0.1, 100), so images written by RayMarch reproduce their own poses.
+*/
+
+struct TrainView
+{
+  std::vector<float3> pixels;    ///< linear RGB in RayMarch pixel order, row 0 at the bottom
+  uint32_t            width  = 0;
+  uint32_t            height = 0;
+  float4x4            worldView; ///< for SetWorldViewMatrix
+  float4x4            proj;      ///< for SetWorldViewMProjatrix
+  float4x4            viewInv;
+  float4x4            projInv;
+};
+
+bool LoadTrainViews(const char* a_posesFile, std::vector<TrainView>* a_views);
+
+struct TrainSettings
+{
+  uint32_t batchRays         = 4096;
+  float    lrDensity         = 10.0f;  ///< Adam step sizes
+  float    lrSH              = 0.03f;
+  uint32_t lrHalfLife        = 200;    ///< iterations after which the step sizes halve, restarts with the optimizer state
+  float    beta1             = 0.9f;
+  float    beta2             = 0.999f;
+  float    epsilon           = 1e-8f;
+  float    tvDensity         = 0.0f;   ///< weights of the total variation terms, 0 disables them
+  float    tvSH              = 0.0f;
+  uint32_t occupancyInterval = 8;      ///< iterations between occupancy rebuilds
+};
+
+/**
+\brief Plenoxels-style optimization of a RayMarcherExample grid on the CPU.
+       Rays are marched with the renderer's own lattice, empty space skipping and trilinear sampling, so the trained
+       grid renders exactly as it was optimized. Every worker accumulates the gradients of its rays in a private
+       sparse buffer (hash of cell -> slot); the buffers are then merged by disjoint cell ranges, so no gradient is
+       ever written by two threads, and TV and Adam visit only the cells that some ray touched.
+*/
+class GridTrainer
+{
+public:
+
+  explicit GridTrainer(RayMarcherExample& a_grid); ///< a_grid must keep fp32 SH; runs on its SetRenderThreads pool, all cores if it has none
+
+  /**
+  \brief one iteration on settings.batchRays random rays of a_views; returns the MSE of the batch
+  */
+  float Step(const std::vector<TrainView>& a_views);
+
+  /**
+  \brief resample the grid to a_gridSize cells per side, then zero density and SH of the cells whose whole 3x3x3
+         neighbourhood has density below a_pruneDensity; optimizer state starts over. false for a grid without fp32 SH
+  */
+  bool Upsample(uint32_t a_gridSize, float a_pruneDensity);
+
+  /**
+  \brief loss over every pixel of a_view, scaled as in Step, plus the TV terms of all cells, and its gradient
+         (PARAMS per cell, density first) from the same backward pass; for gradient checks
+  */
+  double ViewLoss(const TrainView& a_view, std::vector<float>* a_gradient);
+
+  uint32_t Iteration()      const { return m_iteration; }
+  float    SamplesPerRay()  const { return m_raysTraced == 0 ? 0.0f : float(double(m_samplesTaken)/double(m_raysTraced)); } ///< of the Steps since the last Upsample
+  size_t   TouchedCells()   const { return m_lastTouched; }
+  size_t   GetStateBytes()  const; ///< gradients, Adam moments and sparse buffers
+
+  TrainSettings settings;
+
+  static const uint32_t PARAMS = 1 + SH_COEFFS; ///< density and SH of one cell, the layout of all gradient and moment arrays
+
+private:
+
+  struct Sample
+  {
+    uint32_t cells[8];
+    float    weights[8];
+    float    alpha;
+    float    transmittance;
+    float3   color;
+    uint32_t colorMask;      ///< channels that were not clamped at 0
+  };
+
+  struct Worker
+  {
+    std::vector<Sample>   samples;
+    std::vector<uint32_t> table;           ///< open addressing, slot + 1 or 0 for a free entry
+    std::vector<uint32_t> slotCell;        ///< cell of every slot
+    std::vector<float>    slotGradient;    ///< PARAMS per slot
+    std::vector<uint32_t> rangeFirst;      ///< merge range r owns rangeSlots[rangeFirst[r], rangeFirst[r + 1])
+    std::vector<uint32_t> rangeSlots;      ///< slots sorted by merge range, in slot order within a range
+    double                loss         = 0.0;
+    uint64_t              samplesTaken = 0;
+
+    float* Slot(uint32_t a_cell);
+  };
+
+  void  ResetState();
+  float TrainRay(const TrainView& a_view, uint32_t a_x, uint32_t a_y, float a_scale, Worker& a_worker);
+  void  AddTotalVariation(uint32_t a_cell);
+
+  RayMarcherExample&                 m_grid;
+  std::shared_ptr<WorkStealingPool>  m_pool;
+  std::vector<Worker>                m_workers;
+
+  std::vector<float>                 m_gradient;      ///< PARAMS per cell, zero outside of Step
+  std::vector<uint32_t>              m_touchedBits;   ///< bit per cell, set while the cell is in m_rangeCells
+  std::vector<std::vector<uint32_t> > m_rangeCells;   ///< touched cells of every merge range
+  std::vector<float>                 m_moment1;       ///< PARAMS per cell
+  std::vector<float>                 m_moment2;
+  size_t                             m_cells        = 0;
+  uint32_t                           m_iteration    = 0;
+  uint32_t                           m_adamStep     = 0; ///< iterations since the state was reset
+  size_t                             m_lastTouched  = 0;
+  uint64_t                           m_samplesTaken = 0;
+  uint64_t                           m_raysTraced   = 0;
+};
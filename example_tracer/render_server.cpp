@@ -0,0 +1,379 @@
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "render_server.h"
+
+static bool ReadAll(int a_socket, void* a_data, size_t a_size)
+{
+  char* data = (char*)a_data;
+  while (a_size != 0)
+  {
+    const ssize_t got = read(a_socket, data, a_size);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return false;
+    data   += got;
+    a_size -= size_t(got);
+  }
+  return true;
+}
+
+static bool WriteAll(int a_socket, const void* a_data, size_t a_size)
+{
+  const char* data = (const char*)a_data;
+  while (a_size != 0)
+  {
+    const ssize_t sent = write(a_socket, data, a_size);
+    if (sent < 0 && errno == EINTR)
+      continue;
+    if (sent <= 0)
+      return false;
+    data   += sent;
+    a_size -= size_t(sent);
+  }
+  return true;
+}
+
+static bool SocketAddress(const char* a_socketPath, sockaddr_un* a_address)
+{
+  std::memset(a_address, 0, sizeof(sockaddr_un));
+  a_address->sun_family = AF_UNIX;
+  if (std::strlen(a_socketPath) >= sizeof(a_address->sun_path))
+  {
+    std::cout << "[SocketAddress]: path is too long '" << a_socketPath << "'" << std::endl;
+    return false;
+  }
+  std::strcpy(a_address->sun_path, a_socketPath);
+  return true;
+}
+
+int ConnectRenderServer(const char* a_socketPath)
+{
+  sockaddr_un address;
+  if (!SocketAddress(a_socketPath, &address))
+    return -1;
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (const sockaddr*)&address, sizeof(address)) != 0)
+  {
+    std::cout << "[ConnectRenderServer]: can't connect to '" << a_socketPath << "': " << std::strerror(errno) << std::endl;
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool RequestFrame(int a_socket, const RenderRequest& a_request, RenderReply* a_reply, std::vector<uint32_t>* a_pixels)
+{
+  if (!WriteAll(a_socket, &a_request, sizeof(RenderRequest)) || !ReadAll(a_socket, a_reply, sizeof(RenderReply)) ||
+      a_reply->magic != RENDER_REPLY_MAGIC)
+    return false;
+  if (a_reply->status != RENDER_OK)
+    return true;
+  a_pixels->resize(size_t(a_reply->width)*a_reply->height);
+  return ReadAll(a_socket, a_pixels->data(), a_pixels->size()*sizeof(uint32_t));
+}
+
+std::string FrameCache::Key(const RenderRequest& a_request)
+{
+  return std::string((const char*)&a_request.grid, sizeof(RenderRequest) - offsetof(RenderRequest, grid));
+}
+
+bool FrameCache::Find(const RenderRequest& a_request, std::vector<uint32_t>* a_pixels)
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  auto found = m_index.find(Key(a_request));
+  if (found == m_index.end())
+    return false;
+  m_frames.splice(m_frames.begin(), m_frames, found->second);
+  *a_pixels = found->second->second;
+  return true;
+}
+
+void FrameCache::Insert(const RenderRequest& a_request, const std::vector<uint32_t>& a_pixels)
+{
+  const size_t bytes = a_pixels.size()*sizeof(uint32_t);
+  if (bytes > m_capacity)
+    return;
+  std::string key = Key(a_request);
+  std::lock_guard<std::mutex> guard(m_lock);
+  auto found = m_index.find(key);
+  if (found != m_index.end())
+  {
+    m_frames.splice(m_frames.begin(), m_frames, found->second);
+    return;                                    // same key, same size and camera: the frame is already there
+  }
+  while (m_bytes + bytes > m_capacity)
+  {
+    m_bytes -= m_frames.back().second.size()*sizeof(uint32_t);
+    m_index.erase(m_frames.back().first);
+    m_frames.pop_back();
+  }
+  m_frames.emplace_front(key, a_pixels);
+  m_index[key] = m_frames.begin();
+  m_bytes     += bytes;
+}
+
+RenderServer::RenderServer(std::vector<std::shared_ptr<RayMarcherExample> > a_grids, uint32_t a_maxBatch, float a_batchWindowMs, size_t a_cacheBytes,
+                           uint32_t a_maxConnections) :
+  m_grids(std::move(a_grids)), m_maxBatch(std::max(a_maxBatch, 1u)), m_maxConnections(std::max(a_maxConnections, 1u)),
+  m_batchWindow(int64_t(double(a_batchWindowMs)*1000.0)), m_cache(a_cacheBytes)
+{
+  m_renderThread = std::thread(&RenderServer::RenderLoop, this);
+}
+
+RenderServer::~RenderServer()
+{
+  m_quit = true;
+  {
+    // unblock the connection threads in read, they answer nothing more and leave
+    std::unique_lock<std::mutex> lock(m_lock);
+    for (int fd : m_connections)
+      shutdown(fd, SHUT_RDWR);
+    m_changed.wait(lock, [this] { return m_connections.empty(); });
+    m_stopRendering = true;
+  }
+  m_changed.notify_all();
+  m_renderThread.join();
+
+  if (m_listenSocket >= 0)
+  {
+    close(m_listenSocket);
+    unlink(m_socketPath.c_str());
+  }
+}
+
+bool RenderServer::Listen(const char* a_socketPath)
+{
+  sockaddr_un address;
+  if (!SocketAddress(a_socketPath, &address))
+    return false;
+
+  unlink(a_socketPath);
+  m_listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (m_listenSocket < 0 || bind(m_listenSocket, (const sockaddr*)&address, sizeof(address)) != 0 || listen(m_listenSocket, 64) != 0)
+  {
+    std::cout << "[RenderServer::Listen]: can't listen on '" << a_socketPath << "': " << std::strerror(errno) << std::endl;
+    if (m_listenSocket >= 0)
+      close(m_listenSocket);
+    m_listenSocket = -1;
+    return false;
+  }
+  m_socketPath = a_socketPath;
+  return true;
+}
+
+void RenderServer::Serve()
+{
+  while (!m_quit && m_listenSocket >= 0)
+  {
+    pollfd listening = {m_listenSocket, POLLIN, 0};
+    if (poll(&listening, 1, 100) <= 0)
+      continue;
+
+    const int fd = accept(m_listenSocket, nullptr, nullptr);
+    if (fd < 0)
+      continue;
+
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      if (m_connections.size() >= m_maxConnections)
+      {
+        m_stats.refused++;
+        close(fd);                             // the client reads EOF instead of its first reply
+        continue;
+      }
+      m_connections.push_back(fd);
+    }
+    std::thread(&RenderServer::ConnectionLoop, this, fd).detach();
+  }
+}
+
+RenderServerStats RenderServer::GetStats() const
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  return m_stats;
+}
+
+void RenderServer::ConnectionLoop(int a_socket)
+{
+  RenderRequest         request;
+  std::vector<uint32_t> cached;
+  while (!m_quit && ReadAll(a_socket, &request, sizeof(RenderRequest)))
+  {
+    RenderReply reply = {};
+    reply.magic  = RENDER_REPLY_MAGIC;
+    reply.width  = request.width;
+    reply.height = request.height;
+    if (request.magic != RENDER_REQUEST_MAGIC || request.width == 0 || request.height == 0 || request.width > RENDER_MAX_SIDE || request.height > RENDER_MAX_SIDE)
+      reply.status = RENDER_BAD_REQUEST;
+    else if (request.grid >= m_grids.size())
+      reply.status = RENDER_BAD_GRID;
+
+    if (reply.status != RENDER_OK)
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stats.rejected++;
+      }
+      if (request.magic != RENDER_REQUEST_MAGIC || !WriteAll(a_socket, &reply, sizeof(RenderReply)))
+        break; // the stream is out of sync, nothing sensible follows
+      continue;
+    }
+
+    if (m_cache.Find(request, &cached))
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stats.requests++;
+        m_stats.cacheHits++;
+      }
+      if (!WriteAll(a_socket, &reply, sizeof(RenderReply)) || !WriteAll(a_socket, cached.data(), cached.size()*sizeof(uint32_t)))
+        break;
+      continue;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->request = request;
+    job->arrival = std::chrono::high_resolution_clock::now();
+    std::future<void> done = job->done.get_future();
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      m_jobs.push_back(job);
+    }
+    m_changed.notify_all();
+
+    done.wait();
+    if (!WriteAll(a_socket, &job->reply, sizeof(RenderReply)) || !WriteAll(a_socket, job->pixels.data(), job->pixels.size()*sizeof(uint32_t)))
+      break;
+  }
+
+  // closed under the lock, so the destructor never shuts down a reused fd; notified under it too, since once the
+  // destructor sees m_connections empty it may destroy *this, and nothing of it may be touched after the unlock
+  std::lock_guard<std::mutex> guard(m_lock);
+  m_connections.erase(std::find(m_connections.begin(), m_connections.end(), a_socket));
+  close(a_socket);
+  m_changed.notify_all();
+}
+
+void RenderServer::RenderLoop()
+{
+  std::vector<std::shared_ptr<Job> > batch;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_changed.wait(lock, [this] { return m_stopRendering || !m_jobs.empty(); });
+      if (m_jobs.empty())
+        return;
+
+      // requests that arrive together share a batch: wait for more until the oldest one has waited m_batchWindow
+      const auto deadline = m_jobs.front()->arrival + m_batchWindow;
+      m_changed.wait_until(lock, deadline, [this] { return m_stopRendering || m_jobs.size() >= m_maxBatch; });
+
+      const size_t count = std::min(m_jobs.size(), size_t(m_maxBatch));
+      batch.assign(m_jobs.begin(), m_jobs.begin() + count);
+      m_jobs.erase(m_jobs.begin(), m_jobs.begin() + count);
+    }
+    RenderJobs(batch);
+  }
+}
+
+void RenderServer::RenderJobs(std::vector<std::shared_ptr<Job> >& a_jobs)
+{
+  typedef std::chrono::high_resolution_clock clock;
+  const auto start = clock::now();
+
+  // frames cached while the job was queued are answered at once; the rest is grouped by grid and frame size, one
+  // RayMarchBatch per group, and a camera requested twice in the batch is rendered once (copies[i] renders job i)
+  std::map<std::tuple<uint32_t, uint32_t, uint32_t>, std::vector<size_t> > groups;
+  std::vector<size_t> copies(a_jobs.size());
+  uint64_t cacheHits = 0, rendered = 0, batches = 0;
+  for (size_t i = 0; i < a_jobs.size(); i++)
+  {
+    Job& job = *a_jobs[i];
+    job.reply          = {};
+    job.reply.magic    = RENDER_REPLY_MAGIC;
+    job.reply.status   = RENDER_OK;
+    job.reply.width    = job.request.width;
+    job.reply.height   = job.request.height;
+    job.reply.queueMs  = float(std::chrono::duration<double, std::milli>(start - job.arrival).count());
+    copies[i]          = i;
+
+    if (m_cache.Find(job.request, &job.pixels))
+    {
+      cacheHits++;
+      job.done.set_value();
+      continue;
+    }
+
+    std::vector<size_t>& group = groups[std::make_tuple(job.request.grid, job.request.width, job.request.height)];
+    for (size_t other : group)
+      if (std::memcmp(&a_jobs[other]->request, &job.request, sizeof(RenderRequest)) == 0)
+        copies[i] = other;
+    if (copies[i] == i)
+      group.push_back(i);
+  }
+
+  std::vector<float4x4>  views, projs;
+  std::vector<uint32_t*> frames;
+  for (auto& group : groups)
+  {
+    const uint32_t grid   = std::get<0>(group.first);
+    const uint32_t width  = std::get<1>(group.first);
+    const uint32_t height = std::get<2>(group.first);
+    const std::vector<size_t>& members = group.second;
+
+    views.clear();
+    projs.clear();
+    frames.clear();
+    for (size_t i : members)
+    {
+      a_jobs[i]->pixels.resize(size_t(width)*height);
+      views.push_back(a_jobs[i]->request.worldView);
+      projs.push_back(a_jobs[i]->request.proj);
+      frames.push_back(a_jobs[i]->pixels.data());
+    }
+
+    // the frame goes out as soon as its view is done; copies of it wait for the whole group
+    m_grids[grid]->RayMarchBatch(views.data(), projs.data(), frames.data(), uint32_t(members.size()), width, height, [&](uint32_t view)
+    {
+      Job& job = *a_jobs[members[view]];
+      job.reply.batchSize = uint32_t(members.size());
+      job.reply.renderMs  = float(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+      job.done.set_value();
+    });
+    for (size_t i : members)
+      m_cache.Insert(a_jobs[i]->request, a_jobs[i]->pixels);
+    rendered += members.size();
+    batches++;
+  }
+
+  for (size_t i = 0; i < a_jobs.size(); i++)
+  {
+    if (copies[i] == i)
+      continue;
+    Job& job = *a_jobs[i];
+    job.pixels          = a_jobs[copies[i]]->pixels;
+    job.reply.batchSize = a_jobs[copies[i]]->reply.batchSize;
+    job.reply.renderMs  = a_jobs[copies[i]]->reply.renderMs;
+    job.done.set_value();
+  }
+
+  std::lock_guard<std::mutex> guard(m_lock);
+  m_stats.requests  += a_jobs.size();
+  m_stats.cacheHits += cacheHits;
+  m_stats.rendered  += rendered;
+  m_stats.batches   += batches;
+}
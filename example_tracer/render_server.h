@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+
+#include "example_tracer.h"
+
+/**
+  Wire format of the render server, a SOCK_STREAM Unix domain socket in native byte order (both ends run on one
+  machine). A client sends any number of RenderRequest on a connection; for each one it reads a RenderReply and, if
+  status is RENDER_OK, width*height pixels in the RayMarch layout. Requests of one connection are answered in order,
+  so a client that wants several frames in flight opens several connections.
+*/
+
+const uint32_t RENDER_REQUEST_MAGIC = 0x51524752; // "RGRQ"
+const uint32_t RENDER_REPLY_MAGIC   = 0x50524752; // "RGRP"
+const uint32_t RENDER_MAX_SIDE      = 4096;
+
+enum RENDER_STATUS { RENDER_OK = 0, RENDER_BAD_REQUEST = 1, RENDER_BAD_GRID = 2 };
+
+struct RenderRequest
+{
+  uint32_t magic;
+  uint32_t grid;      ///< index of the grid in the order the server loaded them
+  uint32_t width;
+  uint32_t height;
+  float4x4 worldView; ///< as for SetWorldViewMatrix
+  float4x4 proj;      ///< as for SetWorldViewMProjatrix
+};
+
+struct RenderReply
+{
+  uint32_t magic;
+  uint32_t status;    ///< RENDER_STATUS
+  uint32_t width;
+  uint32_t height;
+  uint32_t batchSize; ///< views rendered by the RayMarchBatch call that produced the frame, 0 if it came from the cache
+  uint32_t reserved;
+  float    queueMs;   ///< from the arrival of the request to the start of its batch
+  float    renderMs;  ///< from the start of the batch to the end of this frame
+};
+
+static_assert(sizeof(RenderRequest) == 144, "RenderRequest layout is part of the wire format");
+static_assert(sizeof(RenderReply)   == 32,  "RenderReply layout is part of the wire format");
+
+/**
+\brief client side: connect to a_socketPath, -1 on failure
+*/
+int ConnectRenderServer(const char* a_socketPath);
+
+/**
+\brief client side: send a_request and wait for its reply; false if the connection is broken
+*/
+bool RequestFrame(int a_socket, const RenderRequest& a_request, RenderReply* a_reply, std::vector<uint32_t>* a_pixels);
+
+/**
+\brief least recently used frames, keyed by grid, size and both camera matrices bit for bit; thread safe.
+       Bounded by the bytes of the pixels, so a few large frames can't hold as much memory as many small ones
+*/
+class FrameCache
+{
+public:
+
+  explicit FrameCache(size_t a_maxBytes) : m_capacity(a_maxBytes) {}
+
+  bool Find(const RenderRequest& a_request, std::vector<uint32_t>* a_pixels); ///< copies the frame and makes it the most recent one
+  void Insert(const RenderRequest& a_request, const std::vector<uint32_t>& a_pixels); ///< a frame larger than the cache is not kept
+
+private:
+
+  typedef std::pair<std::string, std::vector<uint32_t> > Entry;
+
+  static std::string Key(const RenderRequest& a_request);
+
+  size_t                                                      m_capacity;  // bytes
+  size_t                                                      m_bytes = 0; // pixel bytes of m_frames
+  std::list<Entry>                                            m_frames; // most recent first
+  std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+  std::mutex                                                  m_lock;
+};
+
+struct RenderServerStats
+{
+  uint64_t requests  = 0; ///< answered with RENDER_OK
+  uint64_t rejected  = 0; ///< answered with an error status
+  uint64_t cacheHits = 0;
+  uint64_t rendered  = 0; ///< views passed to RayMarchBatch
+  uint64_t batches   = 0; ///< RayMarchBatch calls
+  uint64_t refused   = 0; ///< connections closed at once because a_maxConnections were open
+};
+
+/**
+\brief Renders frames of preloaded grids for clients of a Unix domain socket (wire format above).
+       One thread per connection reads requests, answers repeated cameras from the FrameCache at once and queues the
+       rest; a single render thread takes everything that arrived within a_batchWindowMs of the oldest queued request
+       (at most a_maxBatch) and renders it with one RayMarchBatch per grid and frame size. A frame is sent as soon as
+       its view is done, not when the whole batch is. Every connection may hold a frame of up to RENDER_MAX_SIDE^2
+       pixels, so at most a_maxConnections are served at a time; further ones are closed as soon as they are accepted.
+*/
+class RenderServer
+{
+public:
+
+  RenderServer(std::vector<std::shared_ptr<RayMarcherExample> > a_grids, uint32_t a_maxBatch, float a_batchWindowMs, size_t a_cacheBytes,
+               uint32_t a_maxConnections);
+  ~RenderServer(); ///< Stop and wait for the threads
+
+  RenderServer(const RenderServer&)            = delete;
+  RenderServer& operator=(const RenderServer&) = delete;
+
+  bool Listen(const char* a_socketPath); ///< replaces a stale socket file
+  void Serve();                          ///< accepts connections until Stop
+  void Stop() { m_quit = true; }         ///< async signal safe, Serve returns within ~100 ms
+
+  RenderServerStats GetStats() const;
+
+private:
+
+  struct Job
+  {
+    RenderRequest                                  request;
+    RenderReply                                    reply;
+    std::vector<uint32_t>                          pixels;
+    std::chrono::high_resolution_clock::time_point arrival;
+    std::promise<void>                             done;
+  };
+
+  void ConnectionLoop(int a_socket);
+  void RenderLoop();
+  void RenderJobs(std::vector<std::shared_ptr<Job> >& a_jobs);
+
+  std::vector<std::shared_ptr<RayMarcherExample> > m_grids;
+  uint32_t                                          m_maxBatch;
+  uint32_t                                          m_maxConnections;
+  std::chrono::microseconds                         m_batchWindow;
+  FrameCache                                        m_cache;
+
+  std::string                                       m_socketPath;
+  int                                               m_listenSocket = -1;
+  std::atomic<bool>                                 m_quit{false};
+
+  mutable std::mutex                                m_lock;
+  std::condition_variable                           m_changed;
+  std::deque<std::shared_ptr<Job> >                 m_jobs;
+  std::vector<int>                                  m_connections;          // one per connection thread
+  bool                                              m_stopRendering = false;
+  RenderServerStats                                 m_stats;
+  std::thread                                       m_renderThread;
+};
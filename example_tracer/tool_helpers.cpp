@@ -0,0 +1,111 @@
+#include <cmath>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "tool_helpers.h"
+
+LiteImage::Image2D<float4> UnpackRGB(const std::vector<uint32_t>& a_pixels, uint32_t a_width, uint32_t a_height)
+{
+  LiteImage::Image2D<float4> image(a_width, a_height);
+  for(size_t i = 0; i < a_pixels.size(); i++)
+    image.data()[i] = float4(float(a_pixels[i] & 0xFF), float((a_pixels[i] >> 8) & 0xFF), float((a_pixels[i] >> 16) & 0xFF), 0.0f)/255.0f;
+  return image;
+}
+
+float PSNR(const LiteImage::Image2D<float4>& a_image, const LiteImage::Image2D<float4>& a_reference)
+{
+  const float mse = LiteImage::MSE(a_image, a_reference);
+  return mse <= 0.0f ? INFINITY : -10.0f*std::log10(mse);
+}
+
+float PSNR(const std::vector<uint32_t>& a_image, const std::vector<uint32_t>& a_reference, uint32_t a_width, uint32_t a_height)
+{
+  return PSNR(UnpackRGB(a_image, a_width, a_height), UnpackRGB(a_reference, a_width, a_height));
+}
+
+int MaxChannelDiff(const std::vector<uint32_t>& a_image, const std::vector<uint32_t>& a_reference)
+{
+  int maxDiff = 0;
+  for(size_t i = 0; i < a_image.size(); i++)
+    for(int c = 0; c < 24; c += 8)
+      maxDiff = std::max(maxDiff, std::abs(int((a_image[i] >> c) & 0xFF) - int((a_reference[i] >> c) & 0xFF)));
+  return maxDiff;
+}
+
+float Percentile(std::vector<float>& a_values, float a_percent)
+{
+  if(a_values.empty())
+    return 0.0f;
+  std::sort(a_values.begin(), a_values.end());
+  const size_t rank = size_t(std::ceil(a_percent/100.0f*float(a_values.size())));
+  return a_values[std::min(std::max(rank, size_t(1)), a_values.size()) - 1];
+}
+
+std::vector<uint32_t> ParseList(const char* a_list)
+{
+  std::vector<uint32_t> values;
+  std::stringstream list(a_list);
+  for(std::string value; std::getline(list, value, ','); )
+    values.push_back(uint32_t(std::stoul(value)));
+  return values;
+}
+
+float PeakMemoryMB()
+{
+  #if defined(__APPLE__)
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return float(usage.ru_maxrss)/(1024.0f*1024.0f); // bytes
+  #elif defined(__unix__)
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return float(usage.ru_maxrss)/1024.0f;           // kilobytes
+  #else
+  return 0.0f;
+  #endif
+}
+
+float4x4 OrbitView(uint32_t k, uint32_t a_count, float a_distance, float a_elevation)
+{
+  const float elevation = a_elevation*float(int(k % 3) - 1);
+  return lookAt(float3(0.0, 0.0, a_distance), float3(0.0, 0.0, 0.0), float3(0.0, 1.0, 0.0)) * rotate4x4X(elevation*DEG_TO_RAD) *
+         rotate4x4Y(-360.0f*float(k)/float(a_count)*DEG_TO_RAD) * translate4x4(float3(-0.5, -0.5, -0.5));
+}
+
+void BuildSyntheticGrid(RayMarcherExample& a_grid, uint32_t N)
+{
+  a_grid.InitGrid(N);
+  a_grid.SetBoundingBox(float3(0, 0, 0), float3(1, 1, 1));
+
+  const float4 spheres[4] = {float4(0.5f, 0.5f, 0.5f, 0.25f), float4(0.2f, 0.7f, 0.3f, 0.08f),
+                             float4(0.75f, 0.25f, 0.6f, 0.08f), float4(0.3f, 0.3f, 0.8f, 0.08f)};
+  const float  shDC       = 1.0f/0.28209479177387814f;
+  for(uint32_t z = 0; z < N; z++)
+    for(uint32_t y = 0; y < N; y++)
+      for(uint32_t x = 0; x < N; x++)
+      {
+        const size_t cell = x + y*size_t(N) + z*size_t(N)*N;
+        const float3 p    = (float3(float(x), float(y), float(z)) + 0.5f)/float(N);
+
+        float density = (p.y < 0.12f) ? 0.5f : 0.0f;
+        for(int i = 0; i < 4; i++)
+        {
+          const float inside = clamp((spheres[i].w - length(p - to_float3(spheres[i])))*float(N) + 0.5f, 0.0f, 1.0f);
+          density = std::max(density, inside*(i == 0 ? 60.0f : 30.0f));
+        }
+        a_grid.gridDensity[cell] = density;
+
+        float* sh = a_grid.gridSH.data() + cell*SH_COEFFS;
+        std::fill(sh, sh + SH_COEFFS, 0.0f);
+        sh[0*SH_WIDTH] = (0.2f + 0.6f*p.x)*shDC;
+        sh[1*SH_WIDTH] = (0.2f + 0.6f*p.y)*shDC;
+        sh[2*SH_WIDTH] = (0.2f + 0.6f*p.z)*shDC;
+        sh[0*SH_WIDTH + 3] = 0.3f;
+      }
+  a_grid.RebuildOccupancy();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "example_tracer.h"
+#include "Image2d.h"
+
+// helpers shared by testapp and the command line tools (bench_grid, train_grid, serve_grid_client, check_packets)
+
+// LiteImage::MSE on packed uint32_t subtracts whole words, so channels are unpacked to float4 (alpha zeroed) first
+LiteImage::Image2D<float4> UnpackRGB(const std::vector<uint32_t>& a_pixels, uint32_t a_width, uint32_t a_height);
+
+float PSNR(const LiteImage::Image2D<float4>& a_image, const LiteImage::Image2D<float4>& a_reference); ///< INFINITY for equal images
+float PSNR(const std::vector<uint32_t>& a_image, const std::vector<uint32_t>& a_reference, uint32_t a_width, uint32_t a_height);
+int   MaxChannelDiff(const std::vector<uint32_t>& a_image, const std::vector<uint32_t>& a_reference); ///< over r, g, b
+
+float Percentile(std::vector<float>& a_values, float a_percent); ///< nearest rank, a_values gets sorted
+std::vector<uint32_t> ParseList(const char* a_list);            ///< "64,128" -> {64, 128}
+float PeakMemoryMB();                                            ///< peak resident set of the process, 0 where unknown
+
+// camera k of a_count around the unit cube at elevations -a_elevation, 0 and a_elevation degrees, the views of
+// bench_grid, serve_grid_client and the training views of train_grid
+float4x4 OrbitView(uint32_t k, uint32_t a_count, float a_distance = 1.3f, float a_elevation = 20.0f);
+
+// a solid sphere, three small ones and a low haze layer, with position dependent color and a view dependent red lobe;
+// shells fade over one cell, so every grid size renders the same scene
+void BuildSyntheticGrid(RayMarcherExample& a_grid, uint32_t N);
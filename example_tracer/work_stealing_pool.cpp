@@ -0,0 +1,119 @@
+#include <algorithm>
+
+#include "work_stealing_pool.h"
+
+WorkStealingPool::WorkStealingPool(uint32_t a_threads)
+{
+  if (a_threads == 0)
+    a_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (uint32_t i = 0; i < a_threads; i++)
+    m_queues.emplace_back(new Queue);
+
+  for (uint32_t i = 1; i < a_threads; i++)
+    m_workers.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_quit = true;
+  }
+  m_wakeUp.notify_all();
+  for (auto& worker : m_workers)
+    worker.join();
+}
+
+void WorkStealingPool::Run(uint32_t a_taskCount, const std::function<void(uint32_t, uint32_t)>& a_task)
+{
+  if (a_taskCount == 0)
+    return;
+
+  // deal contiguous runs of tasks to each queue: neighbouring tiles stay on one core while there is no stealing
+  const uint32_t threads = ThreadCount();
+  for (uint32_t i = 0; i < threads; i++)
+  {
+    const uint32_t first = uint32_t(uint64_t(a_taskCount)*i/threads);
+    const uint32_t last  = uint32_t(uint64_t(a_taskCount)*(i + 1)/threads);
+    std::lock_guard<std::mutex> guard(m_queues[i]->lock);
+    for (uint32_t task = first; task < last; task++)
+      m_queues[i]->tasks.push_back(task);
+  }
+
+  m_remaining = a_taskCount;
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_task = &a_task;
+    m_busy = uint32_t(m_workers.size());
+    m_generation++;
+  }
+  m_wakeUp.notify_all();
+
+  Drain(0);
+
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_done.wait(lock, [this] { return m_busy == 0; });
+  m_task = nullptr;
+}
+
+void WorkStealingPool::WorkerLoop(uint32_t a_threadId)
+{
+  uint64_t seen = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_wakeUp.wait(lock, [&] { return m_quit || m_generation != seen; });
+      if (m_quit)
+        return;
+      seen = m_generation;
+    }
+
+    Drain(a_threadId);
+
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      m_busy--;
+    }
+    m_done.notify_one();
+  }
+}
+
+void WorkStealingPool::Drain(uint32_t a_threadId)
+{
+  uint32_t task = 0;
+  while (m_remaining.load(std::memory_order_acquire) != 0 && Pop(a_threadId, &task))
+  {
+    (*m_task)(task, a_threadId);
+    m_remaining.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+bool WorkStealingPool::Pop(uint32_t a_threadId, uint32_t* a_task)
+{
+  {
+    Queue& own = *m_queues[a_threadId];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.tasks.empty())
+    {
+      (*a_task) = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+
+  const uint32_t threads = ThreadCount();
+  for (uint32_t i = 1; i < threads; i++)
+  {
+    Queue& victim = *m_queues[(a_threadId + i) % threads];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.tasks.empty())
+    {
+      (*a_task) = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+/**
+\brief Persistent worker threads that execute a batch of independent tasks.
+       Tasks are dealt to per-worker queues up front; a worker that drains its own queue steals from the
+       back of the others, so batches with very uneven task cost (sky tiles vs dense tiles) still balance.
+*/
+class WorkStealingPool
+{
+public:
+
+  explicit WorkStealingPool(uint32_t a_threads = 0);  ///< 0 means std::thread::hardware_concurrency()
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&)            = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  uint32_t ThreadCount() const { return uint32_t(m_queues.size()); }
+
+  /**
+  \brief run a_task(taskId, threadId) for every taskId in [0, a_taskCount); returns when all tasks are done.
+         The calling thread takes part as worker 0, so a pool of one thread runs everything inline.
+  */
+  void Run(uint32_t a_taskCount, const std::function<void(uint32_t, uint32_t)>& a_task);
+
+private:
+
+  struct Queue
+  {
+    std::mutex           lock;
+    std::deque<uint32_t> tasks;
+  };
+
+  void WorkerLoop(uint32_t a_threadId);
+  void Drain(uint32_t a_threadId);
+  bool Pop(uint32_t a_threadId, uint32_t* a_task);
+
+  std::vector<std::unique_ptr<Queue> > m_queues;
+  std::vector<std::thread>             m_workers;
+
+  std::mutex              m_lock;
+  std::condition_variable m_wakeUp;
+  std::condition_variable m_done;
+  uint64_t                m_generation = 0;
+  uint32_t                m_busy       = 0;
+  bool                    m_quit       = false;
+
+  std::atomic<uint32_t>                         m_remaining{0};
+  const std::function<void(uint32_t, uint32_t)>* m_task = nullptr;
+};
@@ -4,8 +4,15 @@
 #include <memory>  // for shared pointers
 #include <iomanip> // for std::fixed/std::setprecision
 #include <sstream>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
 
 #include "example_tracer/example_tracer.h"
+#include "example_tracer/grid_file.h"
+#include "example_tracer/frame_writer.h"
+#include "example_tracer/tool_helpers.h"
 #include "Image2d.h"
 
 #ifdef USE_VULKAN
@@ -38,26 +45,106 @@ int main(int argc, const char** argv)
   #endif
     pImpl = std::make_shared<RayMarcherExample>();
 
+  uint32_t threads     = 0;  // 0 -- all cores
+  uint32_t tileSize    = 32;
+  uint32_t packetWidth = 0;  // 0 -- scalar kernel
+  uint32_t shStorage   = SH_STORAGE_FP32;
+  uint32_t batchSize   = 4;  // views per RayMarchBatch in the batched pass, 0 -- skip it
+  std::string modelPath = "../model.dat"; // raw Cell array or a grid file (see grid_file.h)
+  for(int i = 1; i + 1 < argc; i += 2)
+  {
+    const std::string arg = argv[i];
+    if(arg == "--threads")
+      threads = uint32_t(std::stoul(argv[i+1]));
+    else if(arg == "--tile")
+      tileSize = uint32_t(std::stoul(argv[i+1]));
+    else if(arg == "--packet")
+      packetWidth = (std::string(argv[i+1]) == "auto") ? RayMarcherExample::BestRayPacketWidth() : uint32_t(std::stoul(argv[i+1]));
+    else if(arg == "--sh")
+      shStorage = (std::string(argv[i+1]) == "fp16") ? SH_STORAGE_FP16 : (std::string(argv[i+1]) == "q8") ? SH_STORAGE_Q8 : SH_STORAGE_FP32;
+    else if(arg == "--batch")
+      batchSize = uint32_t(std::stoul(argv[i+1]));
+    else if(arg == "--model")
+      modelPath = argv[i+1];
+  }
+
+  if(!onGPU)
+    pImpl->SetRenderThreads(threads, tileSize);
+
   pImpl->CommitDeviceData();
 
   std::vector<uint> pixelData(WIN_WIDTH*WIN_HEIGHT);
 
-  const size_t gridSize = 128;
-  pImpl->InitGrid(gridSize);
-  pImpl->SetBoundingBox(float3(0, 0, 0), float3(1, 1, 1));
+  auto loadStart = std::chrono::high_resolution_clock::now();
+  if(IsGridFile(modelPath.c_str()))
+  {
+    GridFileStats stats;
+    if(!LoadGridFile(modelPath.c_str(), *pImpl, &stats))
+      return -1;
+    std::cout << "grid file: " << stats.bytesInPlace / (1024*1024) << " MB used in place, " << stats.bytesDecoded / (1024*1024) << " MB decoded" << (stats.mapped ? " (mapped)" : "") << std::endl;
+  }
+  else // legacy raw array of Cell without any header
+  {
+    const size_t gridSize = 128;
+    pImpl->InitGrid(gridSize);
+    pImpl->SetBoundingBox(float3(0, 0, 0), float3(1, 1, 1));
+
+    std::ifstream fin(modelPath, std::ios::in | std::ios::binary);
+    std::vector<Cell> cells(64*1024);
+    for(size_t first = 0; first < pImpl->gridDensity.size() && fin; first += cells.size())
+    {
+      const size_t count = std::min(cells.size(), pImpl->gridDensity.size() - first);
+      fin.read((char*)cells.data(), count * sizeof(Cell));
+      pImpl->LoadCells(cells.data(), first, size_t(fin.gcount()) / sizeof(Cell));
+    }
+    fin.close();
+    pImpl->RebuildOccupancy();
+  }
+  const float loadTime = float(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - loadStart).count())/1000.f;
+  std::cout << "grid load = " << loadTime << " ms, peak RSS = " << PeakMemoryMB() << " MB" << std::endl;
+
   pImpl->SetWorldViewMProjatrix(perspectiveMatrix(45, 1, 0.1, 100));
 
-  std::ifstream fin("../model.dat", std::ios::in | std::ios::binary);
-  fin.read((char*)&pImpl->grid[0], pImpl->grid.size() * sizeof(Cell));
-  fin.close();
+  auto orbitView = [](int k) { return lookAt(float3(0.0, 0.0, 1.3), float3(0.0, 0.0, 0.0), float3(0.0, 1.0, 0.0)) * rotate4x4Y(-float(360.0 / 7 * k)*DEG_TO_RAD) * translate4x4(float3(-0.5, -0.5, -0.5)); };
+
+  std::vector<uint> fp32Data;  // first view with fp32 SH, the reference for other storages
+  if(!onGPU && shStorage != SH_STORAGE_FP32)
+  {
+    pImpl->SetWorldViewMatrix(orbitView(0));
+    pImpl->RayMarch(pixelData.data(), WIN_WIDTH, WIN_HEIGHT);
+    fp32Data = pixelData;
+    float timings[4] = {0,0,0,0};
+    pImpl->GetExecutionTime("RayMarch", timings);
+
+    const size_t fp32Bytes = pImpl->GetSHBytes();
+    pImpl->SetSHStorage(shStorage);
+    std::cout << "SH storage = " << (shStorage == SH_STORAGE_FP16 ? "fp16" : "q8") << ", " << pImpl->GetSHBytes() / (1024*1024) << " MB (fp32: " << fp32Bytes / (1024*1024)
+              << " MB), fp32 reference: timeRender = " << timings[0] << " ms, rays/s = " << float(WIN_WIDTH*WIN_HEIGHT)/(timings[0]*1e-3f) << std::endl;
+  }
 
-  for(int k = 0; k < 7; k++)
+  bool      packetsOk = true;
+  const int viewCount = 7;
+  double    loopMs    = 0.0; // render and save of every view, without the packet check
+  for(int k = 0; k < viewCount; k++)
   {
-    float4x4 viewMat = lookAt(float3(0.0, 0.0, 1.3), float3(0.0, 0.0, 0.0), float3(0.0, 1.0, 0.0)) * rotate4x4Y(-float(360.0 / 7 * k)*DEG_TO_RAD) * translate4x4(float3(-0.5, -0.5, -0.5));
-    pImpl->SetWorldViewMatrix(viewMat);
+    pImpl->SetWorldViewMatrix(orbitView(k));
 
     pImpl->UpdateMembersPlainData();                                            // copy all POD members from CPU to GPU in GPU implementation
-    pImpl->RayMarch(pixelData.data(), WIN_WIDTH, WIN_HEIGHT);
+    if(!onGPU && packetWidth != 0 && k == 0) // packets are checked against the scalar reference on the first view
+    {
+      pImpl->SetRayPacketWidth(0);
+      pImpl->RayMarch(pixelData.data(), WIN_WIDTH, WIN_HEIGHT);
+      std::vector<uint> scalarData = pixelData;
+
+      pImpl->SetRayPacketWidth(packetWidth);
+      pImpl->RayMarch(pixelData.data(), WIN_WIDTH, WIN_HEIGHT);
+
+      const int maxDiff = MaxChannelDiff(pixelData, scalarData);
+      packetsOk = maxDiff <= 1;
+      std::cout << "packet width = " << packetWidth << ", max channel diff to scalar = " << maxDiff << (maxDiff <= 1 ? " (ok)" : " (MISMATCH)") << std::endl;
+    }
+    else
+      pImpl->RayMarch(pixelData.data(), WIN_WIDTH, WIN_HEIGHT);
 
     float timings[4] = {0,0,0,0};
     pImpl->GetExecutionTime("RayMarch", timings);
@@ -69,11 +156,55 @@ int main(int argc, const char** argv)
       strOut << std::fixed << std::setprecision(2) << "out_cpu_" << k << ".bmp";
     std::string fileName = strOut.str();
 
+    const auto saveStart = std::chrono::high_resolution_clock::now();
     LiteImage::SaveBMP(fileName.c_str(), pixelData.data(), WIN_WIDTH, WIN_HEIGHT);
+    loopMs += timings[0] + std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - saveStart).count();
+
+    std::cout << "img no. = " << k << ", timeRender = " << timings[0] << " ms";
+    if(onGPU) // the CPU implementation has no copies and leaves timings[1..3] at zero
+      std::cout << ", timeCopy = " <<  timings[1] + timings[2] << " ms";
+    std::cout << ", rays/s = " << float(WIN_WIDTH*WIN_HEIGHT)/(timings[0]*1e-3f) << ", samplesPerRay = " << pImpl->GetSamplesPerRay();
+    if(k == 0 && !fp32Data.empty())
+      std::cout << ", PSNR to fp32 = " << PSNR(pixelData, fp32Data, WIN_WIDTH, WIN_HEIGHT) << " dB";
+    std::cout << std::endl;
+  }
+
+  std::cout << "view loop: " << viewCount << " frames in " << loopMs << " ms, frames/s = " << 1000.0*viewCount/loopMs << std::endl;
 
-    std::cout << "img no. = " << k << ", timeRender = " << timings[0] << " ms, timeCopy = " <<  timings[1] + timings[2] << " ms " << std::endl;
+  // the same views again as batches of batchSize, written by a background thread from 2*batchSize reused buffers
+  if(!onGPU && batchSize != 0)
+  {
+    AsyncFrameWriter      writer(WIN_WIDTH, WIN_HEIGHT, 2*batchSize);
+    std::vector<float4x4> views, projs;
+    std::vector<uint*>    frames;
+
+    const auto batchStart = std::chrono::high_resolution_clock::now();
+    for(int first = 0; first < viewCount; first += int(batchSize))
+    {
+      const int count = std::min(int(batchSize), viewCount - first);
+      views.clear();
+      projs.clear();
+      frames.clear();
+      for(int k = first; k < first + count; k++)
+      {
+        views.push_back(orbitView(k));
+        projs.push_back(perspectiveMatrix(45, 1, 0.1, 100));
+        frames.push_back(writer.Acquire());
+      }
+      pImpl->RayMarchBatch(views.data(), projs.data(), frames.data(), uint32_t(count), WIN_WIDTH, WIN_HEIGHT, [&](uint32_t view)
+      {
+        writer.Submit(frames[view], "out_cpu_" + std::to_string(first + int(view)) + ".bmp");
+      });
+    }
+    writer.Flush();
+    const double batchMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - batchStart).count();
+
+    std::cout << "batched: " << viewCount << " frames in " << batchMs << " ms, frames/s = " << 1000.0*viewCount/batchMs << " (batch = " << batchSize
+              << ", writer: " << writer.WriteTimeMs() << " ms writing, " << writer.StallTimeMs() << " ms waiting for buffers)" << std::endl;
   }
 
+  std::cout << "peak RSS after rendering = " << PeakMemoryMB() << " MB" << std::endl;
+
   pImpl = nullptr;
-  return 0;
+  return packetsOk ? 0 : 2;
 }
\ No newline at end of file
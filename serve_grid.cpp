@@ -0,0 +1,135 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+
+#include "example_tracer/example_tracer.h"
+#include "example_tracer/grid_file.h"
+#include "example_tracer/render_server.h"
+
+static RenderServer* g_server = nullptr;
+
+static void OnSignal(int)
+{
+  if(g_server != nullptr)
+    g_server->Stop();
+}
+
+// grid file or raw Cell array; the raw grid size comes from the file size, the box is the unit cube like in testapp
+static bool LoadModel(const std::string& a_path, RayMarcherExample& a_grid)
+{
+  if(IsGridFile(a_path.c_str()))
+    return LoadGridFile(a_path.c_str(), a_grid);
+
+  std::ifstream fin(a_path, std::ios::in | std::ios::binary | std::ios::ate);
+  if(!fin)
+  {
+    std::cout << "[LoadModel]: can't open file '" << a_path << "'" << std::endl;
+    return false;
+  }
+  const size_t cellCount = size_t(fin.tellg()) / sizeof(Cell);
+  const size_t gridSize  = size_t(std::lround(std::cbrt(double(cellCount))));
+  if(gridSize == 0 || gridSize*gridSize*gridSize != cellCount)
+  {
+    std::cout << "[LoadModel]: '" << a_path << "' is not a cube of cells" << std::endl;
+    return false;
+  }
+  fin.seekg(0);
+
+  a_grid.InitGrid(gridSize);
+  a_grid.SetBoundingBox(float3(0, 0, 0), float3(1, 1, 1));
+  std::vector<Cell> cells(64*1024);
+  for(size_t first = 0; first < cellCount && fin; first += cells.size())
+  {
+    const size_t count = std::min(cells.size(), cellCount - first);
+    fin.read((char*)cells.data(), count * sizeof(Cell));
+    a_grid.LoadCells(cells.data(), first, size_t(fin.gcount()) / sizeof(Cell));
+  }
+  a_grid.RebuildOccupancy();
+  return true;
+}
+
+// loads the grids once and renders RenderRequest frames for clients of a Unix domain socket, see render_server.h
+int main(int argc, const char** argv)
+{
+  std::string socketPath  = "/tmp/serve_grid.sock";
+  std::string models      = "../model.dat";
+  uint32_t    threads     = 0;
+  uint32_t    tileSize    = 32;
+  uint32_t    packetWidth = 0;
+  uint32_t    shStorage   = SH_STORAGE_FP32;
+  uint32_t    maxBatch    = 8;
+  float       windowMs    = 2.0f;
+  size_t      cacheMB     = 256;
+  uint32_t    maxConns    = 64;
+  for(int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    if(i + 1 >= argc)
+    {
+      std::cout << "usage: serve_grid [--socket /tmp/serve_grid.sock] [--models a.plnx,b.dat] [--threads 0] [--tile 32] [--packet 0|4|8|16|auto]" << std::endl;
+      std::cout << "                  [--sh fp32|fp16|q8] [--max-batch 8] [--window-ms 2] [--cache-mb 256] [--max-connections 64]" << std::endl;
+      return 1;
+    }
+    else if(arg == "--socket")    socketPath  = argv[++i];
+    else if(arg == "--models")    models      = argv[++i];
+    else if(arg == "--threads")   threads     = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--tile")      tileSize    = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--packet")    { const std::string w = argv[++i]; packetWidth = (w == "auto") ? RayMarcherExample::BestRayPacketWidth() : uint32_t(std::stoul(w)); }
+    else if(arg == "--sh")        { const std::string s = argv[++i]; shStorage = (s == "fp16") ? SH_STORAGE_FP16 : (s == "q8") ? SH_STORAGE_Q8 : SH_STORAGE_FP32; }
+    else if(arg == "--max-batch") maxBatch    = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--window-ms") windowMs    = std::stof(argv[++i]);
+    else if(arg == "--cache-mb")  cacheMB     = size_t(std::stoul(argv[++i]));
+    else if(arg == "--max-connections") maxConns = uint32_t(std::stoul(argv[++i]));
+  }
+
+  std::vector<std::shared_ptr<RayMarcherExample> > grids;
+  for(size_t begin = 0; begin <= models.size(); )
+  {
+    const size_t end = std::min(models.find(',', begin), models.size());
+    const std::string path = models.substr(begin, end - begin);
+    begin = end + 1;
+    if(path.empty())
+      continue;
+
+    const auto loadStart = std::chrono::high_resolution_clock::now();
+    auto grid = std::make_shared<RayMarcherExample>();
+    grid->SetRenderThreads(threads, tileSize);
+    if(!LoadModel(path, *grid))
+      return 1;
+    grid->SetRayPacketWidth(packetWidth);
+    if(shStorage != SH_STORAGE_FP32)
+      grid->SetSHStorage(shStorage);
+    std::cout << "grid " << grids.size() << ": '" << path << "', " << grid->gridSize << "^3, loaded in "
+              << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count() << " ms" << std::endl;
+    grids.push_back(grid);
+  }
+  if(grids.empty())
+  {
+    std::cout << "no grids to serve" << std::endl;
+    return 1;
+  }
+
+  RenderServer server(grids, maxBatch, windowMs, cacheMB*1024*1024, maxConns);
+  if(!server.Listen(socketPath.c_str()))
+    return 1;
+
+  g_server = &server;
+  std::signal(SIGINT,  OnSignal);
+  std::signal(SIGTERM, OnSignal);
+  std::signal(SIGPIPE, SIG_IGN);   // a client that hangs up fails the write instead of killing the server
+  std::cout << "serving " << grids.size() << " grid(s) on '" << socketPath << "', batches of up to " << maxBatch << " in " << windowMs
+            << " ms, " << cacheMB << " MB of cached frames, at most " << maxConns << " connections" << std::endl;
+  server.Serve();
+  g_server = nullptr;
+
+  const RenderServerStats stats = server.GetStats();
+  std::cout << "requests = " << stats.requests << ", rejected = " << stats.rejected << ", cache hits = " << stats.cacheHits << ", rendered = "
+            << stats.rendered << " in " << stats.batches << " batches (" << (stats.batches == 0 ? 0.0 : double(stats.rendered)/double(stats.batches))
+            << " views per batch), refused connections = " << stats.refused << std::endl;
+  return 0;
+}
@@ -0,0 +1,169 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+
+#include <unistd.h>
+
+#include "example_tracer/render_server.h"
+#include "example_tracer/tool_helpers.h"
+#include "Image2d.h"
+
+struct LevelResult
+{
+  uint32_t concurrency = 0;
+  uint32_t requests    = 0;
+  uint32_t failed      = 0;
+  uint32_t cacheHits   = 0;
+  float    wallMs      = 0.0f;
+  float    meanBatch   = 0.0f; // over rendered frames
+  float    p50 = 0.0f, p90 = 0.0f, p99 = 0.0f, maxMs = 0.0f;
+};
+
+// load generator for serve_grid: at every concurrency level, that many connections send requests back to back
+int main(int argc, const char** argv)
+{
+  std::string socketPath  = "/tmp/serve_grid.sock";
+  std::vector<uint32_t> concurrency = {1, 2, 4, 8, 16};
+  uint32_t    requests    = 64;  // per concurrency level
+  uint32_t    resolution  = 256;
+  uint32_t    grid        = 0;
+  uint32_t    views       = 0;   // distinct cameras cycled through, 0 -- every request has a new one (no cache hits)
+  std::string savePath;
+  std::string jsonPath    = "serve_grid_client.json";
+  for(int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    if(i + 1 >= argc)
+    {
+      std::cout << "usage: serve_grid_client [--socket /tmp/serve_grid.sock] [--concurrency 1,2,4,8,16] [--requests 64] [--res 256] [--grid 0]" << std::endl;
+      std::cout << "                         [--views 0] [--save first.bmp] [--json serve_grid_client.json]" << std::endl;
+      return 1;
+    }
+    else if(arg == "--socket")      socketPath  = argv[++i];
+    else if(arg == "--concurrency") concurrency = ParseList(argv[++i]);
+    else if(arg == "--requests")    requests    = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--res")         resolution  = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--grid")        grid        = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--views")       views       = uint32_t(std::stoul(argv[++i]));
+    else if(arg == "--save")        savePath    = argv[++i];
+    else if(arg == "--json")        jsonPath    = argv[++i];
+  }
+  std::signal(SIGPIPE, SIG_IGN);
+
+  // cameras never repeat across levels either, unless --views asks for it
+  std::atomic<uint32_t>    cameraIndex(0);
+  const uint32_t           cameraCount = views != 0 ? views : 1u << 20;
+  std::vector<LevelResult> results;
+  for(uint32_t level : concurrency)
+  {
+    std::vector<int> sockets;
+    for(uint32_t c = 0; c < level; c++)
+    {
+      const int fd = ConnectRenderServer(socketPath.c_str());
+      if(fd < 0)
+        return 1;
+      sockets.push_back(fd);
+    }
+
+    std::atomic<uint32_t> next(0);
+    std::vector<std::vector<float> > latencies(level);
+    std::vector<uint32_t> failed(level, 0), cacheHits(level, 0), batchSum(level, 0), rendered(level, 0);
+    auto client = [&](uint32_t c)
+    {
+      std::vector<uint32_t> pixels;
+      for(uint32_t k = next++; k < requests; k = next++)
+      {
+        const uint32_t camera = cameraIndex++;
+        RenderRequest request = {};
+        request.magic     = RENDER_REQUEST_MAGIC;
+        request.grid      = grid;
+        request.width     = resolution;
+        request.height    = resolution;
+        request.worldView = OrbitView(camera % cameraCount, cameraCount);
+        request.proj      = perspectiveMatrix(45, 1, 0.1, 100);
+
+        RenderReply reply;
+        const auto start = std::chrono::high_resolution_clock::now();
+        const bool ok    = RequestFrame(sockets[c], request, &reply, &pixels);
+        latencies[c].push_back(float(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count()));
+        if(!ok || reply.status != RENDER_OK)
+        {
+          failed[c]++;
+          if(!ok)
+            return;
+          continue;
+        }
+        if(reply.batchSize == 0)
+          cacheHits[c]++;
+        else
+        {
+          batchSum[c] += reply.batchSize;
+          rendered[c]++;
+        }
+        if(camera == 0 && !savePath.empty())
+          LiteImage::SaveBMP(savePath.c_str(), pixels.data(), int(reply.width), int(reply.height));
+      }
+    };
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for(uint32_t c = 0; c < level; c++)
+      threads.emplace_back(client, c);
+    for(auto& thread : threads)
+      thread.join();
+    const float wallMs = float(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    for(int fd : sockets)
+      close(fd);
+
+    LevelResult result;
+    result.concurrency = level;
+    result.wallMs      = wallMs;
+    std::vector<float> all;
+    uint32_t batches = 0, frames = 0;
+    for(uint32_t c = 0; c < level; c++)
+    {
+      all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+      result.failed    += failed[c];
+      result.cacheHits += cacheHits[c];
+      batches          += batchSum[c];
+      frames           += rendered[c];
+    }
+    result.requests  = uint32_t(all.size());
+    result.meanBatch = frames == 0 ? 0.0f : float(batches)/float(frames);
+    result.p50   = Percentile(all, 50.0f);
+    result.p90   = Percentile(all, 90.0f);
+    result.p99   = Percentile(all, 99.0f);
+    result.maxMs = all.empty() ? 0.0f : all.back();
+    results.push_back(result);
+
+    std::cout << "concurrency = " << level << ": " << result.requests << " requests in " << wallMs << " ms, requests/s = "
+              << 1000.0f*float(result.requests)/wallMs << ", latency p50 = " << result.p50 << " ms, p90 = " << result.p90 << " ms, p99 = " << result.p99
+              << " ms, max = " << result.maxMs << " ms, views per batch = " << result.meanBatch << ", cache hits = " << result.cacheHits;
+    if(result.failed != 0)
+      std::cout << ", FAILED = " << result.failed;
+    std::cout << std::endl;
+  }
+
+  std::ofstream json(jsonPath);
+  json << "{\n  \"resolution\": " << resolution << ", \"grid\": " << grid << ", \"views\": " << views << ", \"requests\": " << requests << ",\n  \"levels\": [\n";
+  for(size_t i = 0; i < results.size(); i++)
+  {
+    const LevelResult& r = results[i];
+    json << "    {\"concurrency\": " << r.concurrency << ", \"requests\": " << r.requests << ", \"failed\": " << r.failed << ", \"wall_ms\": " << r.wallMs
+         << ", \"requests_per_s\": " << 1000.0f*float(r.requests)/r.wallMs << ", \"p50_ms\": " << r.p50 << ", \"p90_ms\": " << r.p90 << ", \"p99_ms\": " << r.p99
+         << ", \"max_ms\": " << r.maxMs << ", \"views_per_batch\": " << r.meanBatch << ", \"cache_hits\": " << r.cacheHits << "}"
+         << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  json << "  ]\n}\n";
+  std::cout << "wrote '" << jsonPath << "'" << std::endl;
+
+  for(const LevelResult& r : results)
+    if(r.failed != 0)
+      return 2;
+  return 0;
+}
@@ -0,0 +1,174 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <chrono>
+
+#include "example_tracer/example_tracer.h"
+#include "example_tracer/grid_file.h"
+#include "example_tracer/grid_trainer.h"
+#include "example_tracer/tool_helpers.h"
+#include "Image2d.h"
+
+static float ToMB(size_t a_bytes) { return float(double(a_bytes)/(1024.0*1024.0)); }
+
+// renders a_count orbit views of a grid file at three elevations and writes them with a poses file for training
+static int MakeViews(const char* a_gridFile, const std::string& a_folder, uint32_t a_count, uint32_t a_size)
+{
+  RayMarcherExample grid;
+  if(!LoadGridFile(a_gridFile, grid))
+    return 1;
+  grid.SetRenderThreads(0);
+
+  const float fovY = 45.0f;
+  grid.SetWorldViewMProjatrix(perspectiveMatrix(fovY, 1, 0.1, 100));
+
+  std::ofstream poses(a_folder + "/poses.txt");
+  if(!poses)
+  {
+    std::cout << "[MakeViews]: can't write '" << a_folder << "/poses.txt', the folder must exist" << std::endl;
+    return 1;
+  }
+  poses << "# image fovY world-view matrix (row major)" << std::endl;
+  std::vector<uint> pixels(a_size*a_size);
+  for(uint32_t k = 0; k < a_count; k++)
+  {
+    const float4x4 viewMat = OrbitView(k, a_count, 1.3f, 30.0f); // steeper than the bench views, the top and bottom need coverage
+    grid.SetWorldViewMatrix(viewMat);
+    grid.RayMarch(pixels.data(), a_size, a_size);
+
+    std::stringstream name;
+    name << "view_" << std::setw(3) << std::setfill('0') << k << ".bmp";
+    LiteImage::SaveBMP((a_folder + "/" + name.str()).c_str(), pixels.data(), a_size, a_size);
+
+    poses << name.str() << " " << fovY;
+    for(int row = 0; row < 4; row++)
+      for(int col = 0; col < 4; col++)
+        poses << " " << std::setprecision(9) << viewMat(row, col);
+    poses << std::endl;
+  }
+  std::cout << "wrote " << a_count << " views and poses.txt to '" << a_folder << "'" << std::endl;
+  return poses ? 0 : 1;
+}
+
+// PSNR of the first training view rendered with RayMarch, i.e. exactly what testapp would show
+static float EvalPSNR(RayMarcherExample& a_grid, const TrainView& a_view)
+{
+  std::vector<uint> pixels(a_view.width*a_view.height);
+  a_grid.SetWorldViewMProjatrix(a_view.proj);
+  a_grid.SetWorldViewMatrix(a_view.worldView);
+  a_grid.RayMarch(pixels.data(), a_view.width, a_view.height);
+
+  LiteImage::Image2D<float4> target(a_view.width, a_view.height);
+  for(size_t i = 0; i < pixels.size(); i++)
+    target.data()[i] = to_float4(a_view.pixels[i], 0.0f);
+  return PSNR(UnpackRGB(pixels, a_view.width, a_view.height), target);
+}
+
+int main(int argc, const char** argv)
+{
+  if(argc >= 4 && std::string(argv[1]) == "--make-views")
+  {
+    const uint32_t count = (argc > 4) ? uint32_t(std::stoul(argv[4])) : 24;
+    const uint32_t size  = (argc > 5) ? uint32_t(std::stoul(argv[5])) : 128;
+    return MakeViews(argv[2], argv[3], count, size);
+  }
+
+  if(argc < 3)
+  {
+    std::cout << "usage: train_grid <poses.txt> <out.plnx> [--stages 64,128] [--iters 500] [--batch 4096] [--threads N]" << std::endl;
+    std::cout << "                  [--lr-density 10] [--lr-sh 0.03] [--tv-density 0] [--tv-sh 0] [--prune 1]" << std::endl;
+    std::cout << "                  [--init-density 0.1] [--bbox x0 y0 z0 x1 y1 z1]" << std::endl;
+    std::cout << "       train_grid --make-views <grid.plnx> <folder> [count = 24] [size = 128]" << std::endl;
+    return 1;
+  }
+
+  std::vector<uint32_t> stages = {64, 128};
+  uint32_t      iterations  = 500;
+  uint32_t      threads     = 0;
+  float         pruneDensity = 1.0f;
+  float         initDensity = 0.1f;
+  float3        bbMin(0, 0, 0), bbMax(1, 1, 1);
+  TrainSettings settings;
+  for(int i = 3; i + 1 < argc; i += 2)
+  {
+    const std::string arg = argv[i];
+    if(arg == "--stages")            stages               = ParseList(argv[i+1]);
+    else if(arg == "--iters")        iterations           = uint32_t(std::stoul(argv[i+1]));
+    else if(arg == "--batch")        settings.batchRays   = uint32_t(std::stoul(argv[i+1]));
+    else if(arg == "--threads")      threads              = uint32_t(std::stoul(argv[i+1]));
+    else if(arg == "--lr-density")   settings.lrDensity   = std::stof(argv[i+1]);
+    else if(arg == "--lr-sh")        settings.lrSH        = std::stof(argv[i+1]);
+    else if(arg == "--tv-density")   settings.tvDensity   = std::stof(argv[i+1]);
+    else if(arg == "--tv-sh")        settings.tvSH        = std::stof(argv[i+1]);
+    else if(arg == "--prune")        pruneDensity         = std::stof(argv[i+1]);
+    else if(arg == "--init-density") initDensity          = std::stof(argv[i+1]);
+    else if(arg == "--bbox" && i + 6 < argc)
+    {
+      bbMin = float3(std::stof(argv[i+1]), std::stof(argv[i+2]), std::stof(argv[i+3]));
+      bbMax = float3(std::stof(argv[i+4]), std::stof(argv[i+5]), std::stof(argv[i+6]));
+      i += 5;
+    }
+  }
+  if(stages.empty())
+    return 1;
+
+  std::vector<TrainView> views;
+  if(!LoadTrainViews(argv[1], &views) || views.empty())
+    return 1;
+  std::cout << "loaded " << views.size() << " views, peak RSS = " << PeakMemoryMB() << " MB" << std::endl;
+
+  // gray and semi transparent everywhere: SH are clamped at 0, so a zero start would get no color gradients
+  RayMarcherExample grid;
+  grid.InitGrid(stages[0]);
+  grid.SetBoundingBox(bbMin, bbMax);
+  grid.SetRenderThreads(threads);
+  const float shDC = 0.5f/0.28209479177387814f;
+  for(size_t cell = 0; cell < grid.gridDensity.size(); cell++)
+  {
+    grid.gridDensity[cell] = initDensity;
+    for(size_t i = 0; i < SH_COEFFS; i++)
+      grid.gridSH[cell*SH_COEFFS + i] = (i % SH_WIDTH == 0) ? shDC : 0.0f;
+  }
+  grid.RebuildOccupancy();
+
+  GridTrainer trainer(grid); // trains on the render pool of the grid
+  trainer.settings = settings;
+
+  for(size_t stage = 0; stage < stages.size(); stage++)
+  {
+    if(stage != 0)
+    {
+      const auto start = std::chrono::high_resolution_clock::now();
+      if(!trainer.Upsample(stages[stage], pruneDensity))
+        return 1;
+      const float ms = float(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count())/1000.f;
+      std::cout << "upsample to " << stages[stage] << "^3 = " << ms << " ms" << std::endl;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    float loss = 0.0f;
+    for(uint32_t it = 0; it < iterations; it++)
+    {
+      loss = trainer.Step(views);
+      if((it + 1) % 100 == 0)
+        std::cout << "  iter " << it + 1 << ", batch PSNR = " << -10.0f*std::log10(loss) << " dB, touched cells = " << trainer.TouchedCells() << std::endl;
+    }
+    grid.RebuildOccupancy(); // Step rebuilds it only every occupancyInterval iterations, the last ones must be seen
+    const float seconds = float(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count())/1e6f;
+
+    std::cout << "stage " << stage << ": " << stages[stage] << "^3, " << iterations << " iterations in " << seconds << " s, "
+              << float(iterations)/seconds << " it/s, " << float(iterations)*float(settings.batchRays)/seconds << " rays/s, samplesPerRay = " << trainer.SamplesPerRay() << std::endl;
+    std::cout << "  memory: grid = " << ToMB(grid.gridDensity.size()*sizeof(float) + grid.GetSHBytes()) << " MB, trainer = " << ToMB(trainer.GetStateBytes())
+              << " MB, peak RSS = " << PeakMemoryMB() << " MB" << std::endl;
+    std::cout << "  view 0 PSNR = " << EvalPSNR(grid, views[0]) << " dB" << std::endl;
+  }
+
+  if(!SaveGridFile(argv[2], grid, true))
+    return 1;
+  std::cout << "wrote '" << argv[2] << "'" << std::endl;
+  return 0;
+}